@@ -0,0 +1,345 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "alerts.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+#include "web.h"
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace alerts {
+
+namespace {
+
+enum Op : uint8_t
+{
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_EQ,
+    OP_NE
+};
+
+enum Action : uint8_t
+{
+    ACTION_LOG,
+    ACTION_RUN,
+    ACTION_CONNECT,
+    ACTION_DISCONNECT,
+    ACTION_RECONNECT,
+    ACTION_NETWORK_MODE
+};
+
+constexpr const char *opStrs[] = {"<", "<=", ">", ">=", "==", "!="};
+constexpr const char *actionStrs[] =
+{
+    "log", "run", "connect", "disconnect", "reconnect", "network_mode"
+};
+
+// Evaluated on every update, everything else is kept in RuleInfo
+
+struct Rule
+{
+    const void *value;
+    bool (*get)(const void *value, int type, double &val);
+    int getType;
+    double threshold;
+    double hysteresis;
+    TimeType forDuration;
+    TimeType cooldown;
+    TimeType pendingSince;
+    TimeType lastFired;
+    Op op;
+    Action action;
+    bool pending;
+    bool active;
+};
+
+struct RuleInfo
+{
+    std::string text;
+    const char *metric;
+    std::string args; // Command for run, "mode band lteband" for network_mode
+};
+
+std::vector<Rule> rules;
+std::vector<RuleInfo> ruleInfos;
+
+bool test(const Op op, const double val, const double threshold)
+{
+    switch (op)
+    {
+        case OP_LT: return val < threshold;
+        case OP_LE: return val <= threshold;
+        case OP_GT: return val > threshold;
+        case OP_GE: return val >= threshold;
+        case OP_EQ: return val == threshold;
+        case OP_NE: return val != threshold;
+    }
+
+    return false;
+}
+
+// An active rule clears once the value is back past the
+// threshold by at least the hysteresis
+
+bool cleared(const Rule &rule, const double val)
+{
+    switch (rule.op)
+    {
+        case OP_LT:
+        case OP_LE: return val >= rule.threshold + rule.hysteresis;
+        case OP_GT:
+        case OP_GE: return val <= rule.threshold - rule.hysteresis;
+        default: return !test(rule.op, val, rule.threshold);
+    }
+}
+
+bool parseNum(const std::string &str, double &val)
+{
+    char *end;
+    val = strtod(str.c_str(), &end);
+    return end != str.c_str() && !*end;
+}
+
+bool fail(const char *rule, const char *reason, const std::string &token = std::string())
+{
+    if (token.empty()) err.linef("Invalid alert rule \"%s\": %s", rule, reason);
+    else err.linef("Invalid alert rule \"%s\": %s: %s", rule, reason, token.c_str());
+    return false;
+}
+
+void run(const Rule &rule, const RuleInfo &ruleInfo)
+{
+    switch (rule.action)
+    {
+        case ACTION_LOG: break;
+        case ACTION_RUN:
+        {
+            // Don't block the update loop on the command
+            std::string command = ruleInfo.args;
+            std::thread([command]() { (void)system(command.c_str()); }).detach();
+            break;
+        }
+        case ACTION_CONNECT:
+        {
+            if (!web::cli::connect()) err.linef("Alert: Connect failed");
+            break;
+        }
+        case ACTION_DISCONNECT:
+        {
+            if (!web::cli::disconnect()) err.linef("Alert: Disconnect failed");
+            break;
+        }
+        case ACTION_RECONNECT:
+        {
+            if (!web::cli::disconnect() || !web::cli::connect())
+                err.linef("Alert: Reconnect failed");
+            break;
+        }
+        case ACTION_NETWORK_MODE:
+        {
+            std::vector<std::string> args;
+            splitStr(args, ruleInfo.args.c_str(), " ", false);
+
+            if (!web::cli::setNetworkMode(args[0].c_str(), args[1].c_str(), args[2].c_str()))
+                err.linef("Alert: Setting network mode failed");
+            break;
+        }
+    }
+}
+
+} // anonymous namespace
+
+bool compile(const char *str)
+{
+    const char *arrow = strstr(str, "=>");
+    if (!arrow) return fail(str, "Missing '=> <action>'");
+
+    std::vector<std::string> tokens;
+    std::vector<std::string> actionTokens;
+
+    splitStr(tokens, std::string(str, arrow - str).c_str(), " ", false);
+    splitStr(actionTokens, arrow + 2, " ", false);
+
+    if (tokens.size() < 3) return fail(str, "Expected '<metric> [<aggregation>] <op> <threshold>'");
+    if (actionTokens.empty()) return fail(str, "Missing action");
+
+    Rule rule = {};
+    RuleInfo ruleInfo;
+    size_t i = 0;
+
+    ruleInfo.text = str;
+
+    const std::string &metricName = tokens[i++];
+
+    forEachMetric([&](const Metric &metric)
+    {
+        if (rule.value || strcasecmp(metric.name, metricName.c_str())) return;
+        rule.value = metric.value;
+        rule.get = metric.get;
+        ruleInfo.metric = metric.name;
+    });
+
+    if (!rule.value) return fail(str, "Unknown metric", metricName);
+
+    auto getOp = [&](const std::string &token, Op &op)
+    {
+        for (size_t o = 0; o < sizeof(opStrs) / sizeof(*opStrs); o++)
+        {
+            if (token != opStrs[o]) continue;
+            op = (Op)o;
+            return true;
+        }
+        return false;
+    };
+
+    rule.getType = SignalValue<>::GET_CURRENT;
+
+    if (!getOp(tokens[i], rule.op))
+    {
+        rule.getType = SignalValue<>::getGetTypeByStr(tokens[i].c_str());
+        if (rule.getType == SignalValue<>::GET_INVALID) return fail(str, "Invalid aggregation", tokens[i]);
+        if (++i == tokens.size() || !getOp(tokens[i], rule.op)) return fail(str, "Expected operator");
+    }
+
+    if (++i == tokens.size() || !parseNum(tokens[i], rule.threshold))
+        return fail(str, "Expected threshold");
+
+    while (++i < tokens.size())
+    {
+        const std::string &keyword = tokens[i];
+        if (++i == tokens.size()) return fail(str, "Missing value for", keyword);
+        const std::string &val = tokens[i];
+
+        if (keyword == "for")
+        {
+            if (!parseWindowDuration(val.c_str(), rule.forDuration)) return fail(str, "Invalid duration", val);
+        }
+        else if (keyword == "cooldown")
+        {
+            if (!parseWindowDuration(val.c_str(), rule.cooldown)) return fail(str, "Invalid duration", val);
+        }
+        else if (keyword == "hysteresis")
+        {
+            if (!parseNum(val, rule.hysteresis) || rule.hysteresis < 0) return fail(str, "Invalid hysteresis", val);
+        }
+        else
+        {
+            return fail(str, "Unknown keyword", keyword);
+        }
+    }
+
+    const std::string &action = actionTokens[0];
+    size_t a = 0;
+
+    while (a < sizeof(actionStrs) / sizeof(*actionStrs) && action != actionStrs[a]) a++;
+    if (a == sizeof(actionStrs) / sizeof(*actionStrs)) return fail(str, "Unknown action", action);
+
+    rule.action = (Action)a;
+
+    if (rule.action == ACTION_RUN)
+    {
+        const char *command = strstr(arrow, "run") + 3;
+        while (*command == ' ') command++;
+        if (!*command) return fail(str, "Missing command");
+        ruleInfo.args = command;
+    }
+    else if (rule.action == ACTION_NETWORK_MODE)
+    {
+        if (actionTokens.size() != 4) return fail(str, "Expected 'network_mode <mode> <band> <lteband>'");
+        ruleInfo.args = actionTokens[1] + ' ' + actionTokens[2] + ' ' + actionTokens[3];
+    }
+    else if (actionTokens.size() > 1)
+    {
+        return fail(str, "Unexpected argument", actionTokens[1]);
+    }
+
+    rules.push_back(rule);
+    ruleInfos.push_back(std::move(ruleInfo));
+
+    dbg.linef("Alert rule %zu: %s", rules.size(), str);
+
+    return true;
+}
+
+void evaluate()
+{
+    if (rules.empty()) return;
+
+    updateTime();
+
+    for (size_t i = 0; i < rules.size(); i++)
+    {
+        Rule &rule = rules[i];
+        double val;
+
+        if (!rule.get(rule.value, rule.getType, val)) continue;
+
+        if (rule.active)
+        {
+            if (!cleared(rule, val)) continue;
+
+            rule.active = false;
+            info.linef("Alert cleared: %s (%s = %g)", ruleInfos[i].text.c_str(), ruleInfos[i].metric, val);
+            continue;
+        }
+
+        if (!test(rule.op, val, rule.threshold))
+        {
+            rule.pending = false;
+            continue;
+        }
+
+        if (!rule.pending)
+        {
+            rule.pending = true;
+            rule.pendingSince = now;
+        }
+
+        if (rule.forDuration && !timeElapsedGE(rule.pendingSince, rule.forDuration)) continue;
+        if (rule.lastFired && rule.cooldown && !timeElapsedGE(rule.lastFired, rule.cooldown)) continue;
+
+        rule.active = true;
+        rule.pending = false;
+        rule.lastFired = now;
+
+        warn.linef("Alert: %s (%s = %g)", ruleInfos[i].text.c_str(), ruleInfos[i].metric, val);
+        run(rule, ruleInfos[i]);
+    }
+}
+
+bool needsWeb()
+{
+    for (const Rule &rule : rules)
+        if (rule.action >= ACTION_CONNECT) return true;
+    return false;
+}
+
+void clear()
+{
+    rules.clear();
+    ruleInfos.clear();
+}
+
+} // namespace alerts
@@ -0,0 +1,49 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __ALERTS_H__
+#define __ALERTS_H__
+
+/*
+ * Threshold alerts on signal values, configured through alert_rules:
+ *
+ *   <metric> [<aggregation>] <op> <threshold> [for <duration>]
+ *       [hysteresis <delta>] [cooldown <duration>] => <action> [<args>]
+ *
+ *   "sinr Avg30s < 0 for 60s => reconnect"
+ *   "rsrp < -115 hysteresis 3 cooldown 10m => run notify-send 'Weak signal'"
+ *
+ * Aggregations are the signal column suffixes (Avg, Median, Avg30s, ...),
+ * actions: log, run <command>, connect, disconnect, reconnect and
+ * network_mode <mode> <band> <lteband>.
+ *
+ * A rule fires once the condition has held for the given duration and
+ * re-arms after the value went back past threshold +- hysteresis.
+ * Rules are compiled once and evaluated after every update.
+ */
+
+namespace alerts {
+
+bool compile(const char *rule);
+void evaluate();
+bool needsWeb(); // A rule uses a web API action
+void clear();
+
+} // namespace alerts
+
+#endif // __ALERTS_H__
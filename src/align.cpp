@@ -0,0 +1,213 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifdef WORK_IN_PROGRESS
+
+#include "align.h"
+#include "at_tcp.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+
+#include <algorithm>
+
+extern TimeType now;
+
+namespace align {
+
+int peakHold = 3000;
+int frameRate = 60;
+
+namespace {
+
+using x::signal;
+typedef Signal::AT::CERSSI_LTE CERSSI_LTE;
+
+constexpr int BAR_WIDTH = 50;
+constexpr int BAR_HEIGHT = 2;
+
+struct Range
+{
+    int min;
+    int max;
+};
+
+constexpr Range RSRP_RANGE = {-140, -44};
+constexpr Range SINR_RANGE = {-20, 30};
+
+struct Meter
+{
+    bool isSet;
+    int val;
+    int peak;
+    TimeType peakTime;
+
+    // True if anything shown changed
+    bool update(const SignalValue<> &value)
+    {
+        if (!value.isSet()) return false;
+
+        const int newVal = value.getVal();
+
+        if (isSet && newVal == val) return false;
+
+        val = newVal;
+
+        if (!isSet || val >= peak)
+        {
+            peak = val;
+            peakTime = now;
+        }
+
+        isSet = true;
+        return true;
+    }
+
+    bool expirePeak()
+    {
+        if (!isSet || peak == val || timeElapsedLT(peakTime, (TimeType)peakHold)) return false;
+
+        peak = val;
+        peakTime = now;
+        return true;
+    }
+};
+
+Meter rsrp[CERSSI_LTE::MAX_ANTENNAS];
+Meter sinr[CERSSI_LTE::MAX_ANTENNAS];
+
+struct Latency
+{
+    TimeType last; // Microseconds
+    TimeType max;
+    unsigned long long frames;
+    unsigned long long lateFrames;
+};
+
+Latency latency;
+
+int getNumAntennas(const CERSSI_LTE &cerssi)
+{
+    // Old ^CERSSI, see at_tcp's formatSignal()
+    if (cerssi.numAntennas <= 2) return 1;
+    return std::min(cerssi.numAntennas, CERSSI_LTE::MAX_ANTENNAS);
+}
+
+int getBarPos(int val, const Range &range)
+{
+    val = std::max(range.min, std::min(val, range.max));
+    return (val - range.min) * BAR_WIDTH / (range.max - range.min);
+}
+
+void addBar(const char *label, const char *unit, const Meter &meter, const Range &range)
+{
+    const int pos = getBarPos(meter.val, range);
+    const int peakPos = std::min(getBarPos(meter.peak, range), BAR_WIDTH - 1);
+
+    char bar[BAR_WIDTH + 1];
+
+    for (int i = 0; i < BAR_WIDTH; i++) bar[i] = i < pos ? '#' : '-';
+    bar[peakPos] = '|';
+    bar[BAR_WIDTH] = '\0';
+
+    for (int row = 0; row < BAR_HEIGHT; row++)
+    {
+        if (!row) status::format("%-5s %4d %-3s [%s] Peak: %d\n", label, meter.val, unit, bar, meter.peak);
+        else status::format("%-14s [%s]\n", "", bar);
+    }
+}
+
+void render(int numAntennas, TimeType frameTime)
+{
+    status::format("Antenna alignment | Peak hold: %.1f s\n\n", peakHold / float(oneSecond));
+
+    for (int i = 0; i < numAntennas; i++)
+    {
+        StrBuf label;
+        label.format("ANT%d", i + 1);
+
+        status::format("%s\n", label.c_str());
+        addBar("RSRP", "dBm", rsrp[i], RSRP_RANGE);
+        addBar("SINR", "dB", sinr[i], SINR_RANGE);
+        status::addChar('\n');
+    }
+
+    // Of the previous frame, this one isn't written yet
+    status::format("Latency: %.2f ms | Max: %.2f ms | Frame: %.1f ms | Late frames: %llu/%llu\n",
+                   latency.last / 1000.f, latency.max / 1000.f, frameTime / 1000.f,
+                   latency.lateFrames, latency.frames);
+}
+
+} // anonymous namespace
+
+namespace cli {
+using namespace ::cli;
+
+bool run()
+{
+    const TimeType frameTime = oneSecond * 1000 / std::max(frameRate, 1); // Microseconds
+    const unsigned wait = unsigned(std::max(frameTime / 1000, TimeType(1)));
+
+    // Nothing but the screen, sinks would add to the latency
+    at_tcp::publishSamples = false;
+
+    outf("Waiting for LTE ^CERSSI data...\n");
+
+    do
+    {
+        // Returns as soon as data arrives
+        if (!at_tcp::process(wait)) return false;
+
+        updateTime();
+
+        const CERSSI_LTE &cerssi = signal.at.cerssiLTE;
+        if (!cerssi.isSet()) continue;
+
+        const int numAntennas = getNumAntennas(cerssi);
+        bool newSample = false;
+        bool peakExpired = false;
+
+        for (int i = 0; i < numAntennas; i++)
+        {
+            if (rsrp[i].update(cerssi.RSRP[i])) newSample = true;
+            if (sinr[i].update(cerssi.SINR[i])) newSample = true;
+            if (rsrp[i].expirePeak()) peakExpired = true;
+            if (sinr[i].expirePeak()) peakExpired = true;
+        }
+
+        if (!newSample && !peakExpired) continue;
+
+        render(numAntennas, frameTime);
+        status::show(); // Flushed
+
+        if (!newSample) continue;
+
+        latency.last = getMicroSeconds() - at_tcp::getLastReceiveTime();
+        latency.max = std::max(latency.max, latency.last);
+        latency.frames++;
+        if (latency.last > frameTime) latency.lateFrames++;
+
+    } while (!checkExit());
+
+    return true;
+}
+
+} // namespace cli
+
+} // namespace align
+
+#endif
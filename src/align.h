@@ -0,0 +1,44 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __ALIGN_H__
+#define __ALIGN_H__
+
+#ifdef WORK_IN_PROGRESS
+
+/*
+ * Antenna alignment view on the AT push path: one RSRP and SINR bar
+ * per antenna (^CERSSI, LTE) with a short peak hold. A frame is only
+ * drawn when a shown value changed, the time from reading the URC to
+ * the written frame is measured against the frame time.
+ */
+
+namespace align {
+
+extern int peakHold;  // Milliseconds a peak is held
+extern int frameRate; // Frames/s, the latency budget is one frame
+
+namespace cli {
+bool run();
+} // namespace cli
+
+} // namespace align
+
+#endif
+
+#endif // __ALIGN_H__
@@ -0,0 +1,559 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+/*
+ * Mock of the router's AT TCP port for load and reconnect testing
+ * without a router: emits ^CERSSI/^HCSQ/^RSSI URCs to all connected
+ * clients at a configurable rate, optionally fragmented, malformed or
+ * with periodic disconnects, and answers every AT command with OK.
+ *
+ * Script files are sent line by line in a loop, empty lines and lines
+ * starting with '#' are ignored and these directives are supported:
+ *
+ *   @sleep <milliseconds>
+ *   @rate <lines/second>
+ *   @disconnect
+ */
+
+#include "net.h"
+#include "tools.h"
+#include "cli_tools.h"
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace cli;
+
+namespace {
+
+constexpr size_t MAX_CLIENTS = 8;
+constexpr size_t MAX_OUTPUT = 1024 * 1024; // Per client, lines are dropped beyond
+constexpr size_t OVERLONG_LINE = 10000;    // Longer than at_tcp's line buffer
+constexpr size_t MAX_LINES_PER_TICK = 100000;
+
+int port = 20249;
+double rate = 10;
+int fragmentPercent = 0;
+int malformedPercent = 0;
+int disconnectInterval = 0; // Seconds
+int duration = 0;           // Seconds
+const char *scriptFile = nullptr;
+
+std::mt19937 rng;
+
+struct Client
+{
+    net::Socket sock;
+    std::string out;
+    std::string held; // Rest of a fragmented line, sent on the next tick
+    std::string in;
+};
+
+std::vector<Client> clients;
+
+struct Stats
+{
+    unsigned long long lines;
+    unsigned long long fragmented;
+    unsigned long long malformed;
+    unsigned long long dropped;
+    unsigned long long disconnects;
+    unsigned long long commands;
+};
+
+Stats stats;
+
+bool chance(const int percent)
+{
+    return percent > 0 && int(rng() % 100) < percent;
+}
+
+int randomInt(const int min, const int max)
+{
+    return min + int(rng() % unsigned(max - min + 1));
+}
+
+// Script
+
+struct ScriptLine
+{
+    enum Type { LINE, SLEEP, RATE, DISCONNECT } type;
+    std::string text;
+    double val;
+};
+
+std::vector<ScriptLine> script;
+size_t scriptPos;
+
+bool loadScript(const char *file)
+{
+    std::ifstream f(file);
+
+    if (!f)
+    {
+        err.linef("Can't open script '%s'", file);
+        return false;
+    }
+
+    std::string line;
+    size_t lineNo = 0;
+
+    while (std::getline(f, line))
+    {
+        ++lineNo;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        ScriptLine scriptLine{ScriptLine::LINE, line, 0};
+
+        if (line[0] == '@')
+        {
+            std::vector<std::string> args;
+            splitStr(args, line.c_str() + 1, " ", false);
+            const std::string directive = args.empty() ? "" : args[0];
+
+            if (directive == "sleep" && args.size() == 2)
+                scriptLine = {ScriptLine::SLEEP, "", atof(args[1].c_str())};
+            else if (directive == "rate" && args.size() == 2 && atof(args[1].c_str()) > 0)
+                scriptLine = {ScriptLine::RATE, "", atof(args[1].c_str())};
+            else if (directive == "disconnect" && args.size() == 1)
+                scriptLine = {ScriptLine::DISCONNECT, "", 0};
+            else
+            {
+                err.linef("%s:%zu: Invalid directive '%s'", file, lineNo, line.c_str());
+                return false;
+            }
+        }
+
+        script.push_back(scriptLine);
+    }
+
+    // Directives alone would never emit anything
+
+    if (std::none_of(script.begin(), script.end(),
+                     [](const ScriptLine &l) { return l.type == ScriptLine::LINE; }))
+    {
+        err.linef("Script '%s' has no lines", file);
+        return false;
+    }
+
+    return true;
+}
+
+// Built-in sequence: a slow random walk of an LTE signal with four
+// antennas, one ^CERSSI, ^HCSQ and ^RSSI after another
+
+struct Walk
+{
+    int val, min, max;
+
+    int next()
+    {
+        val += randomInt(-1, 1);
+        if (val < min) val = min;
+        if (val > max) val = max;
+        return val;
+    }
+};
+
+Walk rsrp = {-95, -140, -44};
+Walk rsrq = {-10, -20, -3};
+Walk sinr = {12, -20, 30};
+Walk cqi = {10, 0, 15};
+size_t sequencePos;
+
+void generateLine(StrBuf &line)
+{
+    switch (sequencePos++ % 3)
+    {
+        case 0:
+        {
+            const int r = rsrp.next();
+            const int s = sinr.next();
+            const int c = cqi.next();
+
+            line.format("^CERSSI:0,0,255,%d,%d,%d,2,%d,%d,4,%d,%d,%d,%d,%d,%d,%d,%d",
+                        r, rsrq.next(), s, c, c > 0 ? c - 1 : 0,
+                        r, r - randomInt(0, 3), r - randomInt(0, 6), r - randomInt(0, 9),
+                        s, s - randomInt(0, 2), s - randomInt(0, 4), s - randomInt(0, 6));
+            break;
+        }
+        case 1:
+            // Reported values are offsets, see at_tcp's parseHCSQ()
+            line.format("^HCSQ:\"LTE\",%d,%d,%d,%d",
+                        rsrp.val + 120 + 20, rsrp.val + 141,
+                        (sinr.val + 20) * 5, int((rsrq.val + 19.5f) * 2));
+            break;
+        case 2:
+            line.format("^RSSI:%d", (rsrp.val + 140) * 31 / 96);
+            break;
+    }
+}
+
+void malform(std::string &line)
+{
+    switch (rng() % 6)
+    {
+        case 0: // Truncated
+            line.resize(rng() % line.size());
+            break;
+        case 1: // Garbage in place of a field
+            line[randomInt(1, int(line.size()) - 1)] = "x-,\"^ "[rng() % 6];
+            break;
+        case 2: // Overlong
+            line.append(OVERLONG_LINE, '9');
+            break;
+        case 3: // Empty fields
+            line = "^CERSSI:,,,,,,,,,,,,,,,,,";
+            break;
+        case 4: // Unknown URC
+            line = "^MOCK:1,2,3";
+            break;
+        case 5: // Embedded NUL
+            line[randomInt(1, int(line.size()) - 1)] = '\0';
+            break;
+    }
+}
+
+// Clients
+
+void closeClient(size_t i)
+{
+    net::close(clients[i].sock);
+    clients.erase(clients.begin() + long(i));
+}
+
+void disconnectClients()
+{
+    if (clients.empty()) return;
+
+    info.linef("Disconnecting %zu client(s)", clients.size());
+
+    while (!clients.empty()) closeClient(clients.size() - 1);
+    ++stats.disconnects;
+}
+
+void acceptClients(net::Socket server)
+{
+    net::Socket sock;
+
+    while ((sock = net::accept(server)) != net::INVALID_SOCK)
+    {
+        if (clients.size() >= MAX_CLIENTS)
+        {
+            warn.linef("Too many clients, rejecting connection");
+            net::close(sock);
+            continue;
+        }
+
+        clients.push_back({sock, "", "", ""});
+        info.linef("Client connected (%zu connected)", clients.size());
+    }
+}
+
+// Swallows commands and answers each one with OK
+bool readCommands(Client &client)
+{
+    char buf[1024];
+    long rc;
+
+    while ((rc = net::recv(client.sock, buf, sizeof(buf))) > 0)
+    {
+        client.in.append(buf, size_t(rc));
+
+        size_t pos;
+
+        while ((pos = client.in.find('\r')) != std::string::npos)
+        {
+            dbg.linef("Command: %.*s", int(pos), client.in.c_str());
+            client.in.erase(0, pos + 1);
+            client.out += "\r\nOK\r\n";
+            ++stats.commands;
+        }
+
+        if (client.in.size() > sizeof(buf)) client.in.clear();
+    }
+
+    return rc == 0;
+}
+
+bool flush(Client &client)
+{
+    while (!client.out.empty())
+    {
+        const long rc = net::send(client.sock, client.out.data(), client.out.size());
+        if (rc < 0) return false;
+        if (rc == 0) break;
+        client.out.erase(0, size_t(rc));
+    }
+
+    return true;
+}
+
+void broadcast(const std::string &line, bool fragment)
+{
+    // Two pieces, the second goes out on the next tick
+    // so the client sees them in separate segments
+
+    size_t split = 0;
+
+    if (fragment && line.size() > 1)
+    {
+        split = 1 + rng() % (line.size() - 1);
+        ++stats.fragmented;
+    }
+
+    for (Client &client : clients)
+    {
+        if (client.out.size() + client.held.size() + line.size() > MAX_OUTPUT)
+        {
+            ++stats.dropped;
+            continue;
+        }
+
+        if (!client.held.empty())
+        {
+            // Keep the order, the whole line waits for the next tick
+            client.held += line;
+        }
+        else if (split)
+        {
+            client.out.append(line, 0, split);
+            client.held.assign(line, split, std::string::npos);
+        }
+        else
+        {
+            client.out += line;
+        }
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    initTools();
+    cli::init();
+    atexit(cli::deinit);
+
+    unsigned seed = std::random_device()();
+
+    auto printHelp = [&argv]()
+    {
+        outf(stderr,
+             "%s \n"
+             " --port <port> (default: 20249)\n"
+             " --rate <lines/second> (default: 10)\n"
+             " --script <file>\n"
+             " --fragment <percent>\n"
+             " --malformed <percent>\n"
+             " --disconnect-interval <seconds>\n"
+             " --duration <seconds>\n"
+             " --seed <seed>\n", argv[0]);
+        exit(1);
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        auto getArgument = [&]()
+        {
+            char *argument = argv[++i];
+            if (!argument)
+            {
+                err.linef("Missing argument to '%s'", arg);
+                outf(stderr, "\n");
+                printHelp();
+            }
+            return argument;
+        };
+
+        if (!strcmp(arg, "--port")) port = atoi(getArgument());
+        else if (!strcmp(arg, "--rate")) rate = atof(getArgument());
+        else if (!strcmp(arg, "--script")) scriptFile = getArgument();
+        else if (!strcmp(arg, "--fragment")) fragmentPercent = atoi(getArgument());
+        else if (!strcmp(arg, "--malformed")) malformedPercent = atoi(getArgument());
+        else if (!strcmp(arg, "--disconnect-interval")) disconnectInterval = atoi(getArgument());
+        else if (!strcmp(arg, "--duration")) duration = atoi(getArgument());
+        else if (!strcmp(arg, "--seed")) seed = unsigned(atol(getArgument()));
+        else printHelp();
+    }
+
+    if (port <= 0 || port > 65535 || rate <= 0) printHelp();
+
+    rng.seed(seed);
+
+    if (scriptFile && !loadScript(scriptFile)) return 1;
+    if (!net::init()) return 1;
+
+    net::Socket server = net::listen(port);
+
+    if (server == net::INVALID_SOCK)
+    {
+        err.linef("Can't listen on port %d: %s", port, net::getError());
+        net::deinit();
+        return 1;
+    }
+
+    info.linef("Listening on port %d, %g lines/s (seed: %u)", port, rate, seed);
+
+    updateTime();
+
+    const TimeType start = now;
+    TimeType rateStart = now;     // Lines are due relative to this
+    unsigned long long rateLines = 0;
+    TimeType sleepUntil = 0;
+    TimeType lastDisconnect = now;
+    TimeType lastStats = now;
+    Stats lastStatsVal = stats;
+
+    StrBuf line;
+    std::string data;
+
+    while (!checkExit())
+    {
+        net::waitReadable(server, 1);
+
+        updateTime();
+
+        if (duration > 0 && timeElapsedGE(start, TimeType(duration) * oneSecond)) break;
+
+        acceptClients(server);
+
+        // Held back fragments go out before anything new
+
+        for (Client &client : clients)
+        {
+            client.out += client.held;
+            client.held.clear();
+        }
+
+        if (disconnectInterval > 0 && timeElapsedGE(lastDisconnect, TimeType(disconnectInterval) * oneSecond))
+        {
+            disconnectClients();
+            lastDisconnect = now;
+        }
+
+        if (sleepUntil && now < sleepUntil)
+        {
+            // Lines don't pile up while sleeping
+            rateStart = now;
+            rateLines = 0;
+        }
+        else
+        {
+            sleepUntil = 0;
+
+            auto getDue = [&]() { return (unsigned long long)(double(now - rateStart) * rate / oneSecond); };
+            unsigned long long due = getDue();
+            size_t count = 0; // Lines and directives
+
+            while (count < MAX_LINES_PER_TICK && !sleepUntil)
+            {
+                // Directives run as soon as they are reached, lines once due
+
+                const ScriptLine *scriptLine = scriptFile ? &script[scriptPos % script.size()] : nullptr;
+                if ((!scriptLine || scriptLine->type == ScriptLine::LINE) && rateLines >= due) break;
+
+                ++count;
+
+                if (scriptLine)
+                {
+                    ++scriptPos;
+
+                    switch (scriptLine->type)
+                    {
+                        case ScriptLine::LINE: data = scriptLine->text; break;
+                        case ScriptLine::SLEEP: sleepUntil = now + TimeType(scriptLine->val); continue;
+                        case ScriptLine::DISCONNECT: disconnectClients(); continue;
+                        case ScriptLine::RATE:
+                            rate = scriptLine->val;
+                            rateStart = now;
+                            rateLines = 0;
+                            due = getDue();
+                            continue;
+                    }
+                }
+                else
+                {
+                    line.clear();
+                    generateLine(line);
+                    data = line;
+                }
+
+                if (chance(malformedPercent))
+                {
+                    malform(data);
+                    ++stats.malformed;
+                }
+
+                data += "\r\n";
+                broadcast(data, chance(fragmentPercent));
+
+                ++rateLines;
+                ++stats.lines;
+            }
+
+            // Can't keep up, don't try to catch up later
+            if (count == MAX_LINES_PER_TICK)
+            {
+                rateStart = now;
+                rateLines = 0;
+            }
+        }
+
+        for (size_t i = 0; i < clients.size();)
+        {
+            if (!readCommands(clients[i]) || !flush(clients[i]))
+            {
+                info.linef("Client disconnected (%zu connected)", clients.size() - 1);
+                closeClient(i);
+                continue;
+            }
+
+            ++i;
+        }
+
+        if (timeElapsedGE(lastStats, oneSecond))
+        {
+            const double secs = double(now - lastStats) / oneSecond;
+
+            info.linef("Clients: %zu | Lines/s: %.0f | Fragmented: %llu | Malformed: %llu | "
+                       "Dropped: %llu | Disconnects: %llu | Commands: %llu",
+                       clients.size(), double(stats.lines - lastStatsVal.lines) / secs,
+                       stats.fragmented, stats.malformed, stats.dropped,
+                       stats.disconnects, stats.commands);
+
+            lastStats = now;
+            lastStatsVal = stats;
+        }
+    }
+
+    disconnectClients();
+    net::close(server);
+    net::deinit();
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifdef WORK_IN_PROGRESS
+
+#include "at_parse.h"
+#include "huawei_tools.h"
+#include "tools.h"
+#include "cli_tools.h"
+
+#include <cstring>
+
+namespace at_parse {
+
+int scanInts(const char *p, const char *end, int *vals, int maxVals)
+{
+    int count = 0;
+
+    while (count < maxVals)
+    {
+        while (p < end && *p == ' ') p++;
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+        if (p >= end || *p < '0' || *p > '9') break;
+
+        int val = 0;
+
+        do
+        {
+            // Saturate instead of overflowing on garbage
+            if (val < 100000000) val = val * 10 + (*p - '0');
+            p++;
+        } while (p < end && *p >= '0' && *p <= '9');
+
+        vals[count++] = negative ? -val : val;
+
+        if (p >= end || *p != ',') break;
+        p++;
+    }
+
+    return count;
+}
+
+namespace {
+
+bool skipPrefix(const char *&p, const char *end, const char *prefix, size_t length)
+{
+    if (size_t(end - p) < length || memcmp(p, prefix, length)) return false;
+    p += length;
+    return true;
+}
+
+// Avoid name clash with ::signal
+using x::signal;
+
+void parseCERSSI(const char *p, const char *end)
+{
+    int val[3 + 15];
+    const int count = scanInts(p, end, val, 3 + 15);
+
+    if (count == 3 + 15 && val[0] == 0 && val[1] == 0 && val[2] == 255)
+    {
+        /*
+         * 0:  RSRP
+         * 1:  RSRQ
+         * 2:  SINR
+         * 3:  RI
+         * 4:  CQI1
+         * 5:  CQI2
+         * 6:  Num Antennas
+         * 7:  RSRP1
+         * 8:  RSRP2
+         * 9:  RSRP3
+         * 10: RSRP4
+         * 11: SINR1
+         * 12: SINR2
+         * 13: SINR3
+         * 14: SINR4
+         */
+
+        const int *lte = val + 3;
+
+        Signal::AT::CERSSI_LTE &cerssi = signal.at.cerssiLTE;
+        cerssi.lastUpdate = now;
+
+        cerssi.numAntennas = lte[6];
+
+        if (cerssi.numAntennas > Signal::AT::CERSSI_LTE::MAX_ANTENNAS)
+            cerssi.numAntennas = Signal::AT::CERSSI_LTE::MAX_ANTENNAS;
+        else if (cerssi.numAntennas < 0)
+            cerssi.numAntennas = 0;
+
+        cerssi.servingRSRP.update(lte[0]);
+        cerssi.servingSINR.update(lte[2]);
+        cerssi.RSRQ.update(lte[1]);
+        cerssi.RSRP[0].update(lte[7]);
+        cerssi.RSRP[1].update(lte[8]);
+        cerssi.RSRP[2].update(lte[9]);
+        cerssi.RSRP[3].update(lte[10]);
+        cerssi.SINR[0].update(lte[11]);
+        cerssi.SINR[1].update(lte[12]);
+        cerssi.SINR[2].update(lte[13]);
+        cerssi.SINR[3].update(lte[14]);
+        cerssi.RI.update(lte[3]);
+        cerssi.CQI[0].update(lte[4]);
+        cerssi.CQI[1].update(lte[5]);
+    }
+    else if (count >= 3 && val[0] == 0)
+    {
+        /*
+         * 1:  RSCP
+         * 2:  ECIO
+         */
+
+        Signal::AT::CERSSI_WCDMA &cerssi = signal.at.cerssiWCDMA;
+        cerssi.lastUpdate = now;
+
+        cerssi.RSCP.update(val[1]);
+        cerssi.ECIO.update(val[2]);
+    }
+    else if (count >= 1)
+    {
+        /*
+         * 0:  RSSI
+         */
+
+        Signal::AT::CERSSI_GSM &cerssi = signal.at.cerssiGSM;
+        cerssi.lastUpdate = now;
+
+        cerssi.RSSI.update(val[0]);
+    }
+}
+
+void parseHCSQ(const char *p, const char *end)
+{
+    int val[4];
+
+    if (skipPrefix(p, end, "\"LTE\",", 6))
+    {
+        /*
+         * 0:  RSSI
+         * 1:  RSRP
+         * 2:  SINR
+         * 3:  RSRQ
+         */
+
+        if (scanInts(p, end, val, 4) != 4) return;
+
+        Signal::AT::HCSQ_LTE &hcsq = signal.at.hcsqLTE;
+        hcsq.lastUpdate = now;
+
+        hcsq.RSRP.update(val[1] - 141);
+        hcsq.RSRQ.update((val[3] * 0.5f) - 19.5f);
+        hcsq.RSSI.update(val[0] - 120);
+        hcsq.SINR.update((val[2] * 0.2f) - 20.f);
+    }
+    else if (skipPrefix(p, end, "\"WCDMA\",", 8))
+    {
+        /*
+         * 0:  RSSI
+         * 1:  RSCP
+         * 2:  ECIO
+         */
+
+        if (scanInts(p, end, val, 3) != 3) return;
+
+        Signal::AT::HCSQ_WCDMA &hcsq = signal.at.hcsqWCDMA;
+        hcsq.lastUpdate = now;
+
+        hcsq.RSSI.update(val[0] - 120);
+        hcsq.RSCP.update(val[1] - 120);
+        hcsq.ECIO.update((val[2] * 0.5f) - 32.f);
+    }
+    else if (skipPrefix(p, end, "\"GSM\",", 6))
+    {
+        /*
+         * 0:  RSSI
+         */
+
+        if (scanInts(p, end, val, 1) != 1) return;
+
+        Signal::AT::HCSQ_GSM &hcsq = signal.at.hcsqGSM;
+        hcsq.lastUpdate = now;
+
+        hcsq.RSSI.update(val[0] - 120);
+    }
+}
+
+void parseRSSI(const char *p, const char *end)
+{
+    int val;
+    if (scanInts(p, end, &val, 1) != 1) return;
+
+    Signal::AT::RSSI &rssi = signal.at.rssi;
+    rssi.RSSILevel.update(val);
+}
+
+struct Handler
+{
+    const char *prefix;
+    size_t length;
+    URC urc;
+    void (*parse)(const char *p, const char *end);
+};
+
+// TODO: WCDMA, ...
+const Handler handlers[] =
+{
+    { "^CERSSI:", 8, URC_CERSSI, parseCERSSI },
+    { "^HCSQ:",   6, URC_HCSQ,   parseHCSQ   },
+    { "^RSSI:",   6, URC_RSSI,   parseRSSI   }
+};
+
+} // anonymous namespace
+
+URC parse(const char *msg, size_t length)
+{
+    if (!length || *msg != '^') return URC_NONE;
+
+    dbg.linef("Parsing: %.*s", int(length), msg);
+
+    const char *end = msg + length;
+
+    for (const Handler &handler : handlers)
+    {
+        const char *p = msg;
+
+        if (skipPrefix(p, end, handler.prefix, handler.length))
+        {
+            handler.parse(p, end);
+            return handler.urc;
+        }
+    }
+
+    return URC_NONE;
+}
+
+} // namespace at_parse
+
+#endif
@@ -0,0 +1,60 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __AT_PARSE_H__
+#define __AT_PARSE_H__
+
+#ifdef WORK_IN_PROGRESS
+
+#include <cstddef>
+
+/*
+ * Parser for the signal URCs (^CERSSI:, ^HCSQ:, ^RSSI:) and the
+ * matching query results. URCs are dispatched on their prefix, the
+ * fields are read in one pass by scanInts().
+ *
+ * Standalone so that at_parse_fuzz and at_parse_bench can drive it
+ * without a connection.
+ */
+
+namespace at_parse {
+
+enum URC
+{
+    URC_NONE, // Not a known URC
+    URC_CERSSI,
+    URC_HCSQ,
+    URC_RSSI
+};
+
+/*
+ * Comma separated integers as sent by the modem. Stops at the first
+ * field that isn't a number, returns the number of values stored.
+ * Never reads past end, msg doesn't have to be NUL-terminated.
+ */
+
+int scanInts(const char *p, const char *end, int *vals, int maxVals);
+
+// Updates the global signal with the values of a known URC
+URC parse(const char *msg, size_t length);
+
+} // namespace at_parse
+
+#endif
+
+#endif // __AT_PARSE_H__
@@ -0,0 +1,140 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+/*
+ * Time per line of at_parse::parse() against the sscanf cascade it
+ * replaced, for each URC type and a line that is no URC. Both include
+ * the signal updates, which dominate for ^CERSSI: LTE lines, so the
+ * fields of such a line are timed on their own as well.
+ */
+
+#include "at_parse.h"
+#include "at_parse_ref.h"
+#include "huawei_tools.h"
+#include "tools.h"
+#include "cli_tools.h"
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace cli;
+
+namespace {
+
+unsigned long long iterations = 1000000;
+
+const char *const lines[] =
+{
+    "^CERSSI:0,0,255,-95,-11,12,2,10,9,4,-94,-97,-96,-99,14,10,11,9",
+    "^CERSSI:0,-85,-6,0,0,0",
+    "^CERSSI:-67,0,255,0,0,0,0",
+    "^HCSQ:\"LTE\",55,44,170,25",
+    "^HCSQ:\"WCDMA\",40,35,50",
+    "^HCSQ:\"GSM\",50",
+    "^RSSI:20",
+    "^MODE:7,6"
+};
+
+// Nanoseconds per line
+template<typename F>
+double measure(F parse)
+{
+    parse(); // Warm up
+
+    const TimeType start = getNanoSeconds();
+    for (unsigned long long i = 0; i < iterations; i++) parse();
+    return double(getNanoSeconds() - start) / iterations;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    initTools();
+    cli::init();
+    atexit(cli::deinit);
+
+    auto printHelp = [&argv]()
+    {
+        outf(stderr,
+             "%s \n"
+             " --iterations <count> (default: 1000000)\n", argv[0]);
+        exit(1);
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        auto getArgument = [&]()
+        {
+            char *argument = argv[++i];
+            if (!argument)
+            {
+                err.linef("Missing argument to '%s'", arg);
+                outf(stderr, "\n");
+                printHelp();
+            }
+            return argument;
+        };
+
+        if (!strcmp(arg, "--iterations")) iterations = strtoull(getArgument(), nullptr, 10);
+        else printHelp();
+    }
+
+    if (!iterations) printHelp();
+
+    updateTime();
+    disableDebugLog("");
+
+    // As without a database, rollups would time every update
+    rollup_tiers::count = 0;
+
+    static Signal reference;
+
+    outf("%-66s %10s %10s\n", "Line", "at_parse", "sscanf");
+
+    for (const char *line : lines)
+    {
+        const size_t length = strlen(line);
+
+        const double parseTime = measure([&]() { at_parse::parse(line, length); });
+        const double refTime = measure([&]() { at_parse::ref::parse(line, reference); });
+
+        outf("%-66s %7.1f ns %7.1f ns\n", line, parseTime, refTime);
+    }
+
+    const char *lte = lines[0];
+    const char *end = lte + strlen(lte);
+    int val[18];
+
+    const double scanTime = measure([&]() { at_parse::scanInts(lte + 8, end, val, 18); });
+    const double sscanfTime = measure([&]()
+    {
+        sscanf(lte, "^CERSSI:0,0,255,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,",
+                    &val[0], &val[1], &val[2], &val[3], &val[4], &val[5], &val[6],
+                    &val[7], &val[8], &val[9], &val[10], &val[11], &val[12],
+                    &val[13], &val[14]);
+    });
+
+    outf("%-66s %7.1f ns %7.1f ns\n", "Fields of the ^CERSSI: LTE line only", scanTime, sscanfTime);
+
+    return 0;
+}
@@ -0,0 +1,300 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+/*
+ * Mutation check of the URC parser: random edits of well-formed
+ * ^CERSSI/^HCSQ/^RSSI lines are fed to at_parse::parse() and to the
+ * sscanf cascade it replaced, and the signal values each one updates
+ * are compared.
+ *
+ * The parsers are allowed to disagree on non-canonical numbers the
+ * old patterns matched literally ("-0", "+1", "007", whitespace,
+ * more than nine digits), every other difference is reported and
+ * fails the run. Lines are parsed from an exactly sized copy, so
+ * building with -fsanitize=address also catches reads past the end.
+ */
+
+#include "at_parse.h"
+#include "at_parse_ref.h"
+#include "huawei_tools.h"
+#include "tools.h"
+#include "cli_tools.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <memory>
+#include <cctype>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+using namespace cli;
+
+namespace {
+
+constexpr size_t MAX_REPORTED = 10;
+
+unsigned long long iterations = 1000000;
+
+std::mt19937 rng;
+
+const char *const corpus[] =
+{
+    "^CERSSI:0,0,255,-95,-11,12,2,10,9,4,-94,-97,-96,-99,14,10,11,9",
+    "^CERSSI:0,-85,-6,0,0,0",
+    "^CERSSI:-67,0,255,0,0,0,0",
+    "^HCSQ:\"LTE\",55,44,170,25",
+    "^HCSQ:\"WCDMA\",40,35,50",
+    "^HCSQ:\"GSM\",50",
+    "^RSSI:20"
+};
+
+constexpr size_t CORPUS_SIZE = sizeof(corpus) / sizeof(corpus[0]);
+
+// Mostly characters the parser cares about
+const char alphabet[] = "0123456789,,,---+ \t\"^:";
+
+int randomInt(const int min, const int max)
+{
+    return min + int(rng() % unsigned(max - min + 1));
+}
+
+char randomChar()
+{
+    if (rng() % 8 == 0) return char(rng() % 256);
+    return alphabet[rng() % (sizeof(alphabet) - 1)];
+}
+
+std::string mutate(std::string line)
+{
+    const int numEdits = randomInt(1, 4);
+
+    for (int i = 0; i < numEdits; i++)
+    {
+        const size_t pos = line.empty() ? 0 : rng() % line.size();
+
+        switch (rng() % 6)
+        {
+            case 0:
+                if (!line.empty()) line[pos] = randomChar();
+                break;
+            case 1:
+                line.insert(line.begin() + pos, randomChar());
+                break;
+            case 2:
+                if (!line.empty()) line.erase(pos, 1);
+                break;
+            case 3:
+            {
+                // Duplicate a range, e.g. a field
+                const size_t length = rng() % 8;
+                line.insert(pos, line.substr(pos, length));
+                break;
+            }
+            case 4:
+                line.resize(pos);
+                break;
+            case 5:
+            {
+                // Splice with another line
+                const std::string other = corpus[rng() % CORPUS_SIZE];
+                line = line.substr(0, pos) + other.substr(rng() % other.size());
+                break;
+            }
+        }
+    }
+
+    return line;
+}
+
+/*
+ * Input on which the sscanf patterns and scanInts() are known to
+ * differ: the patterns match "0,0,255," literally and sscanf skips
+ * any whitespace, scanInts() reads numbers and skips spaces only.
+ */
+
+bool isCanonical(const std::string &line)
+{
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        const char c = line[i];
+
+        if (c == '+' || isspace((unsigned char)c)) return false;
+        if (!isdigit((unsigned char)c) || (i && isdigit((unsigned char)line[i - 1]))) continue;
+
+        size_t length = 1;
+        while (i + length < line.size() && isdigit((unsigned char)line[i + length])) length++;
+
+        if (length > 9) return false;
+        if (c == '0' && (length > 1 || (i && line[i - 1] == '-'))) return false;
+    }
+
+    return true;
+}
+
+// Fields a parse didn't update keep this value
+
+constexpr int UNSET = std::numeric_limits<int>::min();
+
+template<typename F>
+void forEachValue(Signal::AT &at, F f)
+{
+    f(at.cerssiLTE.servingRSRP);
+    f(at.cerssiLTE.servingSINR);
+    f(at.cerssiLTE.RSRQ);
+    for (auto &val : at.cerssiLTE.RSRP) f(val);
+    for (auto &val : at.cerssiLTE.SINR) f(val);
+    f(at.cerssiLTE.RI);
+    for (auto &val : at.cerssiLTE.CQI) f(val);
+    f(at.cerssiWCDMA.RSCP);
+    f(at.cerssiWCDMA.ECIO);
+    f(at.cerssiGSM.RSSI);
+    f(at.hcsqLTE.RSRP);
+    f(at.hcsqLTE.RSRQ);
+    f(at.hcsqLTE.RSSI);
+    f(at.hcsqLTE.SINR);
+    f(at.hcsqWCDMA.RSSI);
+    f(at.hcsqWCDMA.RSCP);
+    f(at.hcsqWCDMA.ECIO);
+    f(at.hcsqGSM.RSSI);
+    f(at.rssi.RSSILevel);
+}
+
+void unset(Signal::AT &at)
+{
+    forEachValue(at, [](SignalValue<> &val) { val.update(UNSET); });
+    at.cerssiLTE.numAntennas = UNSET;
+}
+
+std::vector<int> getValues(Signal::AT &at)
+{
+    std::vector<int> values;
+    forEachValue(at, [&](SignalValue<> &val) { values.push_back(*val.current); });
+    values.push_back(at.cerssiLTE.numAntennas);
+    return values;
+}
+
+std::string escape(const std::string &line)
+{
+    std::string escaped;
+    char hex[8];
+
+    for (const char c : line)
+    {
+        if (isprint((unsigned char)c))
+        {
+            escaped += c;
+            continue;
+        }
+
+        snprintf(hex, sizeof(hex), "\\x%02x", (unsigned char)c);
+        escaped += hex;
+    }
+
+    return escaped;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    initTools();
+    cli::init();
+    atexit(cli::deinit);
+
+    unsigned seed = 1;
+
+    auto printHelp = [&argv]()
+    {
+        outf(stderr,
+             "%s \n"
+             " --iterations <count> (default: 1000000)\n"
+             " --seed <seed> (default: 1)\n", argv[0]);
+        exit(1);
+    };
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+
+        auto getArgument = [&]()
+        {
+            char *argument = argv[++i];
+            if (!argument)
+            {
+                err.linef("Missing argument to '%s'", arg);
+                outf(stderr, "\n");
+                printHelp();
+            }
+            return argument;
+        };
+
+        if (!strcmp(arg, "--iterations")) iterations = strtoull(getArgument(), nullptr, 10);
+        else if (!strcmp(arg, "--seed")) seed = unsigned(atol(getArgument()));
+        else printHelp();
+    }
+
+    rng.seed(seed);
+    updateTime();
+    disableDebugLog("");
+
+    // Only the values are compared
+    rollup_tiers::count = 0;
+
+    static Signal reference;
+
+    unsigned long long numIdentical = 0;
+    unsigned long long numNonCanonical = 0;
+    unsigned long long numDifferent = 0;
+
+    for (unsigned long long n = 0; n < iterations; n++)
+    {
+        const std::string line = mutate(corpus[n % CORPUS_SIZE]);
+
+        // Exactly sized, not NUL-terminated
+        std::unique_ptr<char[]> msg(new char[line.size() + 1]);
+        memcpy(msg.get(), line.data(), line.size());
+
+        unset(sig.at);
+        at_parse::parse(msg.get(), line.size());
+
+        unset(reference.at);
+        at_parse::ref::parse(line.c_str(), reference);
+
+        if (getValues(sig.at) == getValues(reference.at))
+        {
+            numIdentical++;
+        }
+        else if (!isCanonical(line))
+        {
+            numNonCanonical++;
+        }
+        else
+        {
+            if (numDifferent < MAX_REPORTED) err.linef("Parsers differ on: %s", escape(line).c_str());
+            numDifferent++;
+        }
+    }
+
+    info.linef("%llu lines (seed: %u): %llu identical, %llu non-canonical differences, %llu differences",
+               iterations, seed, numIdentical, numNonCanonical, numDifferent);
+
+    return numDifferent ? 1 : 0;
+}
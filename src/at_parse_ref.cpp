@@ -0,0 +1,154 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifdef WORK_IN_PROGRESS
+
+#include "at_parse_ref.h"
+
+#include <cstdio>
+
+namespace at_parse {
+namespace ref {
+
+void parse(const char *msg, Signal &signal)
+{
+    if (*msg != '^') return;
+
+    int val[16];
+
+    if (sscanf(msg, "^CERSSI:0,0,255,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,",
+                    &val[0], &val[1], &val[2], &val[3], &val[4], &val[5], &val[6],
+                    &val[7], &val[8], &val[9], &val[10], &val[11], &val[12],
+                    &val[13], &val[14]) == 15)
+    {
+        /*
+         * 0:  RSRP
+         * 1:  RSRQ
+         * 2:  SINR
+         * 3:  RI
+         * 4:  CQI1
+         * 5:  CQI2
+         * 6:  Num Antennas
+         * 7:  RSRP1
+         * 8:  RSRP2
+         * 9:  RSRP3
+         * 10: RSRP4
+         * 11: SINR1
+         * 12: SINR2
+         * 13: SINR3
+         * 14: SINR4
+         */
+
+        Signal::AT::CERSSI_LTE &cerssi = signal.at.cerssiLTE;
+
+        cerssi.numAntennas = val[6];
+
+        if (cerssi.numAntennas > Signal::AT::CERSSI_LTE::MAX_ANTENNAS)
+            cerssi.numAntennas = Signal::AT::CERSSI_LTE::MAX_ANTENNAS;
+        else if (cerssi.numAntennas < 0)
+            cerssi.numAntennas = 0;
+
+        cerssi.servingRSRP.update(val[0]);
+        cerssi.servingSINR.update(val[2]);
+        cerssi.RSRQ.update(val[1]);
+        cerssi.RSRP[0].update(val[7]);
+        cerssi.RSRP[1].update(val[8]);
+        cerssi.RSRP[2].update(val[9]);
+        cerssi.RSRP[3].update(val[10]);
+        cerssi.SINR[0].update(val[11]);
+        cerssi.SINR[1].update(val[12]);
+        cerssi.SINR[2].update(val[13]);
+        cerssi.SINR[3].update(val[14]);
+        cerssi.RI.update(val[3]);
+        cerssi.CQI[0].update(val[4]);
+        cerssi.CQI[1].update(val[5]);
+    }
+    else if (sscanf(msg, "^CERSSI:0,%d,%d,0,0,0", &val[0], &val[1]) == 2)
+    {
+        /*
+         * 0:  RSCP
+         * 1:  ECIO
+         */
+
+        Signal::AT::CERSSI_WCDMA &cerssi = signal.at.cerssiWCDMA;
+
+        cerssi.RSCP.update(val[0]);
+        cerssi.ECIO.update(val[1]);
+    }
+    else if (sscanf(msg, "^CERSSI:%d,0,255,0,0,0,0", &val[0]) == 1)
+    {
+        /*
+         * 0:  RSSI
+         */
+
+        Signal::AT::CERSSI_GSM &cerssi = signal.at.cerssiGSM;
+
+        cerssi.RSSI.update(val[0]);
+    }
+    else if (sscanf(msg, "^HCSQ:\"LTE\",%d,%d,%d,%d",
+                         &val[0], &val[1], &val[2], &val[3]) == 4)
+    {
+        /*
+         * 0:  RSSI
+         * 1:  RSRP
+         * 2:  SINR
+         * 3:  RSRQ
+         */
+
+        Signal::AT::HCSQ_LTE &hcsq = signal.at.hcsqLTE;
+
+        hcsq.RSRP.update(val[1] - 141);
+        hcsq.RSRQ.update((val[3] * 0.5f) - 19.5f);
+        hcsq.RSSI.update(val[0] - 120);
+        hcsq.SINR.update((val[2] * 0.2f) - 20.f);
+    }
+    else if (sscanf(msg, "^HCSQ:\"WCDMA\",%d,%d,%d", &val[0], &val[1], &val[2]) == 3)
+    {
+        /*
+         * 0:  RSSI
+         * 1:  RSCP
+         * 2:  ECIO
+         */
+
+        Signal::AT::HCSQ_WCDMA &hcsq = signal.at.hcsqWCDMA;
+
+        hcsq.RSSI.update(val[0] - 120);
+        hcsq.RSCP.update(val[1] - 120);
+        hcsq.ECIO.update((val[2] * 0.5f) - 32.f);
+    }
+    else if (sscanf(msg, "^HCSQ:\"GSM\",%d", &val[0]) == 1)
+    {
+        /*
+         * 0:  RSSI
+         */
+
+        Signal::AT::HCSQ_GSM &hcsq = signal.at.hcsqGSM;
+
+        hcsq.RSSI.update(val[0] - 120);
+    }
+    else if (sscanf(msg, "^RSSI: %d", &val[0]) == 1)
+    {
+        Signal::AT::RSSI &rssi = signal.at.rssi;
+        rssi.RSSILevel.update(val[0]);
+    }
+}
+
+} // namespace ref
+} // namespace at_parse
+
+#endif
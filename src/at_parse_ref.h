@@ -0,0 +1,43 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __AT_PARSE_REF_H__
+#define __AT_PARSE_REF_H__
+
+#ifdef WORK_IN_PROGRESS
+
+#include "huawei_tools.h"
+
+/*
+ * The sscanf cascade at_parse replaced, kept as the reference for
+ * at_parse_fuzz and the baseline for at_parse_bench. Not part of the
+ * tool itself.
+ */
+
+namespace at_parse {
+namespace ref {
+
+// msg must be NUL-terminated
+void parse(const char *msg, Signal &signal);
+
+} // namespace ref
+} // namespace at_parse
+
+#endif
+
+#endif // __AT_PARSE_REF_H__
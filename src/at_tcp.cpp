@@ -19,12 +19,20 @@
 #ifdef WORK_IN_PROGRESS
 
 #include "at_tcp.h"
+#include "at_parse.h"
 #include "huawei_tools.h"
 #include "tools.h"
 #include "cli_tools.h"
+#include "pipeline.h"
+#include "stream.h"
+#include "line_buffer.h"
+#include "net.h"
+#include "serial.h"
 
-#include <cstdio>
-#include <SDL2/SDL_net.h>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
 
 extern TimeType now;
 
@@ -32,16 +40,113 @@ namespace at_tcp {
 
 char routerIP[128] = "";
 int routerPort = 0;
+char serialDevice[256] = "";
+int serialBaudRate = 115200;
+int silenceTimeout = 30;
+int commandPipelineDepth = 4;
+bool publishSamples = true;
+std::vector<std::string> initCommands;
 
 namespace {
-TCPsocket sock = nullptr;
-SDLNet_SocketSet sockset = nullptr;
+constexpr unsigned CONNECT_TIMEOUT = 5000;
+constexpr TimeType MIN_RECONNECT_DELAY = oneSecond;
+constexpr TimeType MAX_RECONNECT_DELAY = oneMinute;
+constexpr TimeType URC_RATE_WINDOW = 10 * oneSecond;
+
+net::Socket sock = net::INVALID_SOCK;
+net::Poller *poller = nullptr;
 TimeType lastRecv;
+TimeType lastRecvMicros; // Of the latest read, not only the first one
 TimeType lastRecvWarning;
 TimeType lastCERSSI;
 TimeType lastCERSSIWarning;
 TimeType connectMillis;
-static void parse(const char *msg);
+LineBuffer<8192> recvBuffer;
+
+// Reconnect state, kept across connections
+TimeType reconnectDelay = MIN_RECONNECT_DELAY;
+TimeType nextReconnect;
+unsigned reconnects;
+
+// TCP reconnects don't block process(): the socket is watched for
+// writability until the connect completes or the deadline passes
+std::vector<net::Address> addresses; // Resolved by the first connect()
+size_t addressIndex;                 // The one being tried
+net::Socket connectingSock = net::INVALID_SOCK;
+TimeType connectDeadline;
+
+uint64_t numURCs;
+uint64_t urcWindowStart;
+TimeType urcWindowTime;
+float urcRate;
+
+struct Command
+{
+    std::string text;
+    std::string responsePrefix; // e.g. "^HCSQ:" for AT^HCSQ?
+    unsigned timeout;
+    TimeType deadline;
+    bool sent;
+    CommandCallback callback;
+    CommandResponse response;
+};
+
+// Sent commands first, in order, responses arrive in the same order
+std::deque<Command> commands;
+size_t numInFlight;
+size_t numOrphanedResults; // Final results still due for timed out commands
+
+// Other streams served from process()
+std::map<net::Socket, EventHandler> watchers;
+LineHandler urcHandler = nullptr;
+
+void parse(const char *msg, size_t length)
+{
+    const at_parse::URC urc = at_parse::parse(msg, length);
+    if (urc == at_parse::URC_NONE) return;
+
+    numURCs++;
+    if (urc == at_parse::URC_CERSSI) lastCERSSI = now;
+}
+
+// The stream is either a TCP socket or, on POSIX systems, a serial
+// port's file descriptor, the poller takes both
+
+bool isSerial()
+{
+    return serialDevice[0];
+}
+
+long readStream(char *buf, size_t length)
+{
+    if (isSerial()) return serial::read(serial::Port(sock), buf, length);
+    return net::recv(sock, buf, length);
+}
+
+bool writeStream(const char *data, size_t length)
+{
+    if (isSerial()) return serial::writeAll(serial::Port(sock), data, length, CONNECT_TIMEOUT);
+    return net::sendAll(sock, data, length, CONNECT_TIMEOUT);
+}
+
+void closeStream()
+{
+    if (isSerial())
+    {
+        serial::Port port = serial::Port(sock);
+        serial::close(port);
+        sock = net::INVALID_SOCK;
+    }
+    else
+    {
+        net::close(sock);
+    }
+}
+
+const char *getStreamError()
+{
+    return isSerial() ? serial::getError() : net::getError();
+}
 
 void resetTimeValues()
 {
@@ -57,7 +162,7 @@ void printWarnings()
     constexpr TimeType NO_DATA_WARN_INTERVAL = 5000;
     constexpr TimeType NO_CERSSI_WARN_INTERVAL = 15000;
 
-    if (timeElapsedGE(lastRecv, NO_DATA_WARN_INTERVAL) &&
+    if (timeElapsedGE(TP(lastRecv, connectMillis), NO_DATA_WARN_INTERVAL) &&
         timeElapsedGE(lastRecvWarning, NO_DATA_WARN_INTERVAL))
     {
         warn.linef("Received no data within %llu seconds",
@@ -77,225 +182,591 @@ void printWarnings()
     }
 }
 
-} // anonymous namespace
+void updateURCRate()
+{
+    if (!urcWindowTime)
+    {
+        urcWindowTime = now;
+        urcWindowStart = numURCs;
+        return;
+    }
 
-AT_TCP_Error connect()
+    const TimeType elapsed = getElapsedTime(urcWindowTime);
+    if (elapsed < URC_RATE_WINDOW) return;
+
+    urcRate = float(numURCs - urcWindowStart) * oneSecond / elapsed;
+    urcWindowTime = now;
+    urcWindowStart = numURCs;
+}
+
+bool isFinalResult(const char *line, bool &ok)
 {
-    resetTimeValues();
+    static const char *const errors[] =
+    {
+        "ERROR", "NO CARRIER", "COMMAND NOT SUPPORT", "TOO MANY PARAMETERS"
+    };
+
+    ok = !strcmp(line, "OK");
+    if (ok) return true;
 
-    dbg.linef("Resolving %s ...", routerIP);
+    for (const char *error : errors)
+        if (!strcmp(line, error)) return true;
 
-    IPaddress address;
-    if (SDLNet_ResolveHost(&address, routerIP, routerPort) == -1)
+    return !strncmp(line, "+CME ERROR:", 11) || !strncmp(line, "+CMS ERROR:", 11);
+}
+
+void completeCommand(CommandResult result, const char *finalResult)
+{
+    Command command = std::move(commands.front());
+    commands.pop_front();
+    if (command.sent) numInFlight--;
+
+    dbg.linef("%s: %s", command.text.c_str(), *finalResult ? finalResult : getCommandResultStr(result));
+
+    if (!command.callback)
     {
-        dbg.linef("Could not resolve hostname");
-        errfunf("Could not resolve hostname");
-        return AT_TCP_Error::COULD_NOT_RESOLVE_HOSTNAME;
+        if (result != COMMAND_OK)
+            warn.linef("AT command %s failed: %s", command.text.c_str(),
+                       *finalResult ? finalResult : getCommandResultStr(result));
+        return;
     }
 
-    dbg.linef("... done");
+    command.response.result = result;
+    command.response.finalResult = finalResult;
+    command.callback(command.response);
+}
 
-    if (!(sock = SDLNet_TCP_Open(&address)))
+void failInFlightCommands()
+{
+    while (numInFlight) completeCommand(COMMAND_DISCONNECTED, "");
+    numOrphanedResults = 0;
+}
+
+void sendCommands()
+{
+    if (sock == net::INVALID_SOCK) return;
+
+    const size_t depth = std::max(commandPipelineDepth, 1);
+
+    for (size_t i = numInFlight; i < commands.size() && numInFlight < depth; i++)
     {
-        dbg.linef("%s", SDLNet_GetError());
-        errfunf("Could not connect");
-        return AT_TCP_Error::COULD_NOT_CONNECT;
+        Command &command = commands[i];
+
+        std::string line = command.text;
+        line += '\r';
+
+        if (!writeStream(line.c_str(), line.length()))
+        {
+            // The next recv reports the broken connection
+            dbg.linef("Sending %s failed: %s", command.text.c_str(), getStreamError());
+            return;
+        }
+
+        command.sent = true;
+        command.deadline = now + command.timeout;
+        numInFlight++;
+    }
+}
+
+void checkCommandDeadlines()
+{
+    while (numInFlight && now >= commands.front().deadline)
+    {
+        // Its final result may still arrive and must not be taken for
+        // the next command's
+        numOrphanedResults++;
+        completeCommand(COMMAND_TIMEOUT, "");
+    }
+}
+
+void handleLine(const char *line, size_t length)
+{
+    if (!length) return;
+
+    bool ok;
+
+    if (isFinalResult(line, ok))
+    {
+        if (numOrphanedResults) numOrphanedResults--;
+        else if (numInFlight) completeCommand(ok ? COMMAND_OK : COMMAND_ERROR, line);
+        else dbg.linef("Unexpected final result: %s", line);
+
+        sendCommands();
+        return;
+    }
+
+    if (numInFlight && !numOrphanedResults)
+    {
+        Command &command = commands.front();
+
+        // Echo (ATE1)
+        if (command.text == line) return;
+
+        // Intermediate lines are either prefixed like the command or
+        // plain text, other ^/+ lines are URCs in between
+
+        if ((*line != '^' && *line != '+') ||
+            (!command.responsePrefix.empty() &&
+             !strncmp(line, command.responsePrefix.c_str(), command.responsePrefix.length())))
+        {
+            command.response.lines.emplace_back(line, length);
+
+            // Query results such as ^HCSQ: are the same as the URCs,
+            // parse them as well
+            parse(line, length);
+            return;
+        }
     }
 
+    if (urcHandler) urcHandler(line, length);
+    parse(line, length);
+}
+
+// The stream is open and watched
+void startStream()
+{
     updateTime();
     connectMillis = now;
 
-    SDLNet_TCP_AddSocket(sockset, sock);
+    // Don't glue a stale partial line to the new stream
+    recvBuffer.reset();
 
-    return AT_TCP_Error::OK;
+    for (const std::string &command : initCommands)
+        sendCommand(command.c_str(), 10 * oneSecond, nullptr);
+
+    sendCommands();
 }
 
-void disconnect()
+void scheduleReconnect()
 {
-    if (!sock) return;
-    dbg.linef("Disconnecting ...");
-    SDLNet_TCP_Close(sock);
-    dbg.linef("... done");
-    sock = nullptr;
+    nextReconnect = now + reconnectDelay;
+    reconnectDelay = std::min(reconnectDelay * 2, MAX_RECONNECT_DELAY);
 }
 
-bool process(unsigned wait)
+void dropConnection(const char *reason)
+{
+    warn.linef("AT connection lost (%s), reconnecting in %llu seconds",
+               reason, reconnectDelay / oneSecond);
+
+    disconnect();
+    scheduleReconnect();
+}
+
+void startConnect()
+{
+    const net::Address &address = addresses[addressIndex];
+
+    dbg.linef("Connecting to %s:%d (address %zu of %zu) ...",
+              routerIP, routerPort, addressIndex + 1, addresses.size());
+
+    connectingSock = net::startConnect(address);
+
+    if (connectingSock == net::INVALID_SOCK)
+    {
+        dbg.linef("%s", net::getError());
+        return;
+    }
+
+    if (!poller->add(connectingSock, nullptr) || !poller->setWantWrite(connectingSock, true))
+    {
+        dbg.linef("%s", net::getError());
+        poller->remove(connectingSock);
+        net::close(connectingSock);
+        return;
+    }
+
+    connectDeadline = now + CONNECT_TIMEOUT;
+}
+
+void cancelConnect()
+{
+    poller->remove(connectingSock);
+    net::close(connectingSock);
+}
+
+// The next address right away, the first one again after the delay
+void connectFailed()
 {
     updateTime();
-    printWarnings();
 
-    // TODO: Handle interrupt
+    while (++addressIndex < addresses.size())
+    {
+        startConnect();
+        if (connectingSock != net::INVALID_SOCK) return;
+    }
+
+    addressIndex = 0;
+    scheduleReconnect();
+}
 
-    if (SDLNet_CheckSockets(sockset, wait) < 0)
+// The connecting socket reported writable or hangup
+void finishConnect()
+{
+    if (!net::finishConnect(connectingSock))
     {
-        dbg.linef("%s", SDLNet_GetError());
-        errfunf("Checking sockets failed");
-        return false;
+        dbg.linef("%s", net::getError());
+        cancelConnect();
+        connectFailed();
+        return;
     }
 
-    if (!SDLNet_SocketReady(sock)) return true;
+    dbg.linef("... done");
+
+    poller->setWantWrite(connectingSock, false);
+    sock = connectingSock;
+    connectingSock = net::INVALID_SOCK;
+    addressIndex = 0;
 
-    char msg[4096];
-    char line[4096];
-    const char *msgPtr = msg;
+    resetTimeValues();
+    startStream();
 
-    int recvLength = SDLNet_TCP_Recv(sock, msg, sizeof(msg) - 1);
+    reconnects++;
+    info.linef("AT connection re-established (reconnect #%u)", reconnects);
+}
 
-    if (recvLength <= 0)
+void reconnect()
+{
+    if (connectingSock != net::INVALID_SOCK)
     {
-        dbg.linef("%s", SDLNet_GetError());
-        errfunf("Receiving data failed");
-        return false;
+        if (now < connectDeadline) return;
+
+        dbg.linef("Timed out after %u ms", CONNECT_TIMEOUT);
+        cancelConnect();
+        connectFailed();
+        return;
     }
 
-    msg[recvLength] = '\0';
+    if (now < nextReconnect) return;
 
-    updateTime();
-    lastRecv = now;
+    // Opening a serial port doesn't block for long
+
+    if (isSerial())
+    {
+        if (connect() != AT_TCP_Error::OK)
+        {
+            updateTime();
+            scheduleReconnect();
+            return;
+        }
+
+        reconnects++;
+        info.linef("AT connection re-established (reconnect #%u)", reconnects);
+        return;
+    }
+
+    // Only if the first connect() couldn't resolve the host
 
-    while (getLine(msgPtr, line, sizeof(line)))
+    if (addresses.empty() && !net::resolve(routerIP, routerPort, addresses))
     {
-        if (!*line) continue;
-        parse(line);
+        dbg.linef("Could not resolve hostname");
+        scheduleReconnect();
+        return;
     }
 
-    return true;
+    startConnect();
+    if (connectingSock == net::INVALID_SOCK) connectFailed();
 }
 
-namespace {
-
-void parse(const char *msg)
+bool receive()
 {
-    if (*msg != '^') return;
+    // Drain everything pending, partial lines are kept until the rest
+    // arrives
 
-    dbg.linef("Parsing: %s", msg);
+    bool received = false;
 
-    if (!strncmp(msg, "^CERSSI", 6))
-        lastCERSSI = now;
+    for (;;)
+    {
+        const long recvLength = readStream(recvBuffer.getWritePtr(),
+                                           recvBuffer.getWritable());
 
-    int val[16];
+        if (!recvLength) break;
 
-    // TODO: WCDMA, ...
+        if (recvLength < 0)
+        {
+            dbg.linef("%s", getStreamError());
+            dropConnection("receiving data failed");
+            return received;
+        }
 
-    // Avoid name clash with ::signal
-    using x::signal;
+        if (!received)
+        {
+            updateTime();
+            lastRecv = now;
+            received = true;
 
-    if (sscanf(msg, "^CERSSI:0,0,255,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,",
-                    &val[0], &val[1], &val[2], &val[3], &val[4], &val[5], &val[6],
-                    &val[7], &val[8], &val[9], &val[10], &val[11], &val[12],
-                    &val[13], &val[14]) == 15)
-    {
-        /*
-         * 0:  RSRP
-         * 1:  RSRQ
-         * 2:  SINR
-         * 3:  RI
-         * 4:  CQI1
-         * 5:  CQI2
-         * 6:  Num Antennas
-         * 7:  RSRP1
-         * 8:  RSRP2
-         * 9:  RSRP3
-         * 10: RSRP4
-         * 11: SINR1
-         * 12: SINR2
-         * 13: SINR3
-         * 14: SINR4
-         */
+            // The stream works, start over with short delays
+            reconnectDelay = MIN_RECONNECT_DELAY;
+        }
 
-        Signal::AT::CERSSI_LTE &cerssi = signal.at.cerssiLTE;
+        lastRecvMicros = getMicroSeconds();
+        recvBuffer.commit(recvLength, handleLine);
+    }
 
-        cerssi.numAntennas = val[6];
+    return received;
+}
 
-        if (cerssi.numAntennas > Signal::AT::CERSSI_LTE::MAX_ANTENNAS)
-            cerssi.numAntennas = Signal::AT::CERSSI_LTE::MAX_ANTENNAS;
-        else if (cerssi.numAntennas < 0)
-            cerssi.numAntennas = 0;
+AT_TCP_Error openSerial()
+{
+    dbg.linef("Opening %s at %d baud ...", serialDevice, serialBaudRate);
+
+    const serial::Port port = serial::open(serialDevice, serialBaudRate);
 
-        cerssi.RSRQ.update(val[1]);
-        cerssi.RSRP[0].update(val[7]);
-        cerssi.RSRP[1].update(val[8]);
-        cerssi.RSRP[2].update(val[9]);
-        cerssi.RSRP[3].update(val[10]);
-        cerssi.SINR[0].update(val[11]);
-        cerssi.SINR[1].update(val[12]);
-        cerssi.SINR[2].update(val[13]);
-        cerssi.SINR[3].update(val[14]);
-        cerssi.RI.update(val[3]);
-        cerssi.CQI[0].update(val[4]);
-        cerssi.CQI[1].update(val[5]);
+    if (port == serial::INVALID_PORT)
+    {
+        dbg.linef("%s", serial::getError());
+        errfunf("Could not open %s", serialDevice);
+        return AT_TCP_Error::COULD_NOT_CONNECT;
     }
-    else if (sscanf(msg, "^CERSSI:0,%d,%d,0,0,0", &val[0], &val[1]) == 2)
+
+    sock = net::Socket(port);
+    return AT_TCP_Error::OK;
+}
+
+AT_TCP_Error openTCP()
+{
+    dbg.linef("Connecting to %s:%d ...", routerIP, routerPort);
+
+    if (addresses.empty() && !net::resolve(routerIP, routerPort, addresses))
     {
-        /*
-         * 0:  RSCP
-         * 1:  ECIO
-         */
+        dbg.linef("Could not resolve hostname");
+        errfunf("Could not resolve hostname");
+        return AT_TCP_Error::COULD_NOT_RESOLVE_HOSTNAME;
+    }
 
-        Signal::AT::CERSSI_WCDMA &cerssi = signal.at.cerssiWCDMA;
+    net::ConnectError error;
+    sock = net::connect(addresses, CONNECT_TIMEOUT, error);
 
-        cerssi.RSCP.update(val[0]);
-        cerssi.ECIO.update(val[1]);
+    switch (error)
+    {
+        case net::CONNECT_OK:
+            break;
+
+        case net::CONNECT_TIMED_OUT:
+            dbg.linef("Timed out after %u ms", CONNECT_TIMEOUT);
+            errfunf("Could not connect");
+            return AT_TCP_Error::COULD_NOT_CONNECT;
+
+        case net::CONNECT_FAILED:
+            dbg.linef("%s", net::getError());
+            errfunf("Could not connect");
+            return AT_TCP_Error::COULD_NOT_CONNECT;
     }
-    else if (sscanf(msg, "^CERSSI:%d,0,255,0,0,0,0", &val[0]) == 1)
+
+    return AT_TCP_Error::OK;
+}
+
+} // anonymous namespace
+
+AT_TCP_Error connect()
+{
+    resetTimeValues();
+
+    const AT_TCP_Error rc = isSerial() ? openSerial() : openTCP();
+    if (rc != AT_TCP_Error::OK) return rc;
+
+    dbg.linef("... done");
+
+    if (!poller->add(sock, nullptr))
     {
-        /*
-         * 0:  RSSI
-         */
+        dbg.linef("%s", net::getError());
+        errfunf("Could not watch socket");
+        closeStream();
+        return AT_TCP_Error::COULD_NOT_CONNECT;
+    }
+
+    startStream();
+
+    return AT_TCP_Error::OK;
+}
+
+void disconnect()
+{
+    if (connectingSock != net::INVALID_SOCK) cancelConnect();
+    if (sock == net::INVALID_SOCK) return;
+    dbg.linef("Disconnecting ...");
+    poller->remove(sock);
+    closeStream();
+    dbg.linef("... done");
+
+    // Unsent commands are kept for the next connection
+    failInFlightCommands();
+
+    const LineCounters &counters = recvBuffer.getCounters();
+    dbg.linef("Received %llu bytes, %llu lines, discarded %llu overlong lines",
+              (unsigned long long)counters.bytes, (unsigned long long)counters.lines,
+              (unsigned long long)counters.discardedLines);
+}
+
+bool process(unsigned wait)
+{
+    updateTime();
+    updateURCRate();
+    checkCommandDeadlines();
+    sendCommands();
 
-        Signal::AT::CERSSI_GSM &cerssi = signal.at.cerssiGSM;
+    if (sock == net::INVALID_SOCK)
+    {
+        // Signal::AT values are left alone, statistics continue
+        // where they stopped
 
-        cerssi.RSSI.update(val[0]);
+        reconnect();
     }
-    else if (sscanf(msg, "^HCSQ:\"LTE\",%d,%d,%d,%d",
-                         &val[0], &val[1], &val[2], &val[3]) == 4)
+    else if (silenceTimeout > 0 &&
+             timeElapsedGE(TP(lastRecv, connectMillis), silenceTimeout * oneSecond))
     {
-        /*
-         * 0:  RSSI
-         * 1:  RSRP
-         * 2:  SINR
-         * 3:  RSRQ
-         */
+        dropConnection("no data");
+    }
+    else
+    {
+        printWarnings();
+    }
+
+    if (!poller->size())
+    {
+        delay(wait);
+        return true;
+    }
+
+    // TODO: Handle interrupt
 
-        Signal::AT::HCSQ_LTE &hcsq = signal.at.hcsqLTE;
+    net::Poller::Event events[16];
+    const int numEvents = poller->wait(events, 16, wait);
 
-        hcsq.RSRP.update(val[1] - 141);
-        hcsq.RSRQ.update((val[3] * 0.5f) - 19.5f);
-        hcsq.RSSI.update(val[0] - 120);
-        hcsq.SINR.update((val[2] * 0.2f) - 20.f);
+    if (numEvents < 0)
+    {
+        dbg.linef("%s", net::getError());
+        errfunf("Checking sockets failed");
+        return false;
     }
-    else if (sscanf(msg, "^HCSQ:\"WCDMA\",%d,%d,%d", &val[0], &val[1], &val[2]) == 3)
+
+    bool received = false;
+
+    for (int i = 0; i < numEvents; i++)
     {
-        /*
-         * 0:  RSSI
-         * 1:  RSCP
-         * 2:  ECIO
-         */
+        const net::Poller::Event &event = events[i];
+
+        if (event.sock == sock)
+        {
+            if (receive()) received = true;
+            continue;
+        }
 
-        Signal::AT::HCSQ_WCDMA &hcsq = signal.at.hcsqWCDMA;
+        if (event.sock == connectingSock)
+        {
+            finishConnect();
+            continue;
+        }
 
-        hcsq.RSSI.update(val[0] - 120);
-        hcsq.RSCP.update(val[1] - 120);
-        hcsq.ECIO.update((val[2] * 0.5f) - 32.f);
+        // A handler may have closed it for an earlier event
+        auto watcher = watchers.find(event.sock);
+        if (watcher != watchers.end()) watcher->second(event);
     }
-    else if (sscanf(msg, "^HCSQ:\"GSM\",%d", &val[0]) == 1)
+
+    if (!received || !publishSamples) return true;
+
+    pipeline::onSample();
+
+    return true;
+}
+
+const LineCounters &getLineCounters()
+{
+    return recvBuffer.getCounters();
+}
+
+const char *getCommandResultStr(CommandResult result)
+{
+    switch (result)
     {
-        /*
-         * 0:  RSSI
-         */
+        case COMMAND_OK: return "OK";
+        case COMMAND_ERROR: return "ERROR";
+        case COMMAND_TIMEOUT: return "Timeout";
+        case COMMAND_DISCONNECTED: return "Disconnected";
+    }
 
-        Signal::AT::HCSQ_GSM &hcsq = signal.at.hcsqGSM;
+    return "Unknown";
+}
+
+bool sendCommand(const char *command, unsigned timeout, CommandCallback callback)
+{
+    constexpr size_t MAX_QUEUED_COMMANDS = 64;
+
+    if (strncasecmp(command, "AT", 2) || strpbrk(command, "\r\n"))
+    {
+        errfunf("Invalid AT command: %s", command);
+        return false;
+    }
 
-        hcsq.RSSI.update(val[0] - 120);
+    if (commands.size() >= MAX_QUEUED_COMMANDS)
+    {
+        errfunf("Too many queued AT commands");
+        return false;
     }
-    else if (sscanf(msg, "^RSSI: %d", &val[0]) == 1)
+
+    Command cmd;
+    cmd.text = command;
+    cmd.timeout = timeout;
+    cmd.deadline = 0;
+    cmd.sent = false;
+    cmd.callback = std::move(callback);
+
+    // AT^HCSQ? -> ^HCSQ:, AT+COPS=3,0 -> +COPS:
+
+    const char *name = command + 2;
+
+    if (*name == '^' || *name == '+')
     {
-        Signal::AT::RSSI &rssi = signal.at.rssi;
-        rssi.RSSILevel.update(val[0]);
+        cmd.responsePrefix.assign(name, strcspn(name, "?=;"));
+        cmd.responsePrefix += ':';
     }
+
+    commands.push_back(std::move(cmd));
+
+    updateTime();
+    sendCommands();
+
+    return true;
 }
 
-} // anonymous namespace
+bool watch(net::Socket sock, EventHandler handler)
+{
+    if (!poller->add(sock, nullptr)) return false;
+    watchers[sock] = handler;
+    return true;
+}
+
+bool setWantWrite(net::Socket sock, bool wantWrite)
+{
+    return poller->setWantWrite(sock, wantWrite);
+}
+
+void unwatch(net::Socket sock)
+{
+    poller->remove(sock);
+    watchers.erase(sock);
+}
+
+void setURCHandler(LineHandler handler)
+{
+    urcHandler = handler;
+}
+
+TimeType getLastReceiveTime()
+{
+    return lastRecvMicros;
+}
+
+Health getHealth()
+{
+    Health health;
+
+    health.connected = sock != net::INVALID_SOCK;
+    health.uptime = health.connected ? getElapsedTime(connectMillis) : 0;
+    health.reconnects = reconnects;
+    health.urcRate = urcRate;
+
+    return health;
+}
 
 namespace cli {
 using namespace ::cli;
@@ -411,6 +882,21 @@ bool printStats()
     }
 
     status::addColumns(signalColumns, columnSpacing);
+
+    const Health health = getHealth();
+
+    if (health.connected)
+    {
+        StrBuf uptime;
+        status::format("Connected: %s | Reconnects: %u | URCs: %.1f/s\n",
+                       fmtMillis(health.uptime, uptime).c_str(),
+                       health.reconnects, health.urcRate);
+    }
+    else
+    {
+        status::format("Reconnecting ... | Reconnects: %u\n", health.reconnects);
+    }
+
     status::show();
 
     return true;
@@ -418,8 +904,47 @@ bool printStats()
 
 } // anonymous namespace
 
+bool runCommand(const char *command)
+{
+    bool done = false;
+    bool ok = false;
+
+    auto printResponse = [&done, &ok](const CommandResponse &response)
+    {
+        for (const std::string &line : response.lines)
+            outf("%s\n", line.c_str());
+
+        outf("%s\n", response.finalResult[0] ? response.finalResult
+                                             : getCommandResultStr(response.result));
+
+        ok = response.result == COMMAND_OK;
+        done = true;
+    };
+
+    if (!sendCommand(command, 10 * oneSecond, printResponse)) return false;
+
+    do
+    {
+        if (!process(50)) return false;
+    } while (!done && !checkExit());
+
+    return ok;
+}
+
 bool showSignalStrength()
 {
+    if (stream::isEnabled())
+    {
+        // No screen output, process() streams every sample
+
+        do
+        {
+            if (!process(50)) return false;
+        } while (!checkExit());
+
+        return true;
+    }
+
     outf("Waiting for signal strength data... This may take up to 10 seconds.\n");
 
     do
@@ -435,17 +960,19 @@ bool showSignalStrength()
 
 void init()
 {
-    SDLNet_Init();
-    sockset = SDLNet_AllocSocketSet(1);
-    if (!sockset) abort();
+    if (!net::init()) abort();
+    poller = new net::Poller;
 }
 
 void deinit()
 {
-    if (!sockset) return;
-    SDLNet_FreeSocketSet(sockset);
-    sockset = nullptr;
-    SDLNet_Quit();
+    if (!poller) return;
+
+    while (!commands.empty()) completeCommand(COMMAND_DISCONNECTED, "");
+
+    delete poller;
+    poller = nullptr;
+    net::deinit();
 }
 
 } // namespace at_tcp
@@ -21,10 +21,24 @@
 
 #ifdef WORK_IN_PROGRESS
 
+#include "line_buffer.h"
+#include "tools.h"
+#include "net.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
 namespace at_tcp {
 
 extern char routerIP[128];
 extern int routerPort;
+extern char serialDevice[256]; // Modem port (e.g. /dev/ttyUSB2) used instead of TCP if set
+extern int serialBaudRate;
+extern int silenceTimeout; // Seconds without data until reconnecting, 0 = never
+extern int commandPipelineDepth; // Commands sent before the first one is answered
+extern std::vector<std::string> initCommands; // Sent after every connect
+extern bool publishSamples; // Off when the caller merges and publishes the values itself
 
 enum AT_TCP_Error
 {
@@ -36,10 +50,66 @@ enum AT_TCP_Error
 AT_TCP_Error connect();
 void disconnect();
 bool process(unsigned wait);
+const LineCounters &getLineCounters();
+
+struct Health
+{
+    bool connected;
+    TimeType uptime;
+    unsigned reconnects;
+    float urcRate; // Per second
+};
+
+Health getHealth();
+
+// getMicroSeconds() of the read the latest parsed lines came from
+TimeType getLastReceiveTime();
+
+// Other streams (e.g. proxy clients) waited for together with the AT
+// stream, handlers run from process()
+
+typedef void (*EventHandler)(const net::Poller::Event &event);
+
+bool watch(net::Socket sock, EventHandler handler);
+bool setWantWrite(net::Socket sock, bool wantWrite);
+void unwatch(net::Socket sock);
+
+// Lines that aren't part of a command response
+typedef void (*LineHandler)(const char *line, size_t length);
+void setURCHandler(LineHandler handler);
+
+// Command channel
+//
+// Commands are queued and written to the stream as the pipeline depth
+// allows. Final results (OK, ERROR, +CME ERROR: ...) are matched in
+// order, intermediate lines are collected until then. URCs in between
+// are parsed as usual. Callbacks run from process().
+
+enum CommandResult
+{
+    COMMAND_OK,
+    COMMAND_ERROR,
+    COMMAND_TIMEOUT,
+    COMMAND_DISCONNECTED
+};
+
+struct CommandResponse
+{
+    CommandResult result;
+    const char *finalResult; // Empty on timeout/disconnect
+    std::vector<std::string> lines;
+};
+
+typedef std::function<void(const CommandResponse &response)> CommandCallback;
+
+const char *getCommandResultStr(CommandResult result);
+// timeout counts from when the command is written
+bool sendCommand(const char *command, unsigned timeout, CommandCallback callback);
 
 namespace cli {
 extern char columns[64];
 extern int columnSpacing;
+bool runCommand(const char *command);
 bool showSignalStrength();
 } // namespace cli
 
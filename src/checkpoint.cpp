@@ -0,0 +1,460 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "checkpoint.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace checkpoint {
+
+char path[256] = "";
+int interval = 60;
+
+namespace {
+
+constexpr char MAGIC[] = "HWCKPT01";
+constexpr size_t MAGIC_LENGTH = sizeof(MAGIC) - 1;
+
+typedef SignalValue<> RadioValue;
+typedef SignalValue<TimeType> DurationValue;
+typedef SignalValue<unsigned long long, true> SpeedValue;
+
+std::string activePath;
+TimeType lastWrite = 0;
+std::thread writer;
+
+template<typename F>
+void forEachRadioValue(RadioValues &values, F &&f)
+{
+    RadioValue *const list[] =
+    {
+        &values.RSCP, &values.ECIO, &values.RSRP, &values.RSRQ, &values.RSSI, &values.SINR,
+        &values.CQI[0], &values.CQI[1], &values.DLMCS[0], &values.DLMCS[1], &values.UPMCS,
+        &values.TXPWrPPUSCH, &values.TXPWrPPUCCH, &values.TXPWrPSRS, &values.TXPWrPPRACH
+    };
+
+    for (RadioValue *value : list) f(*value);
+}
+
+template<typename F>
+void forEachAtValue(Signal::AT &at, F &&f)
+{
+    f(at.cerssiLTE.servingRSRP);
+    f(at.cerssiLTE.servingSINR);
+    f(at.cerssiLTE.RSRQ);
+    for (auto &value : at.cerssiLTE.RSRP) f(value);
+    for (auto &value : at.cerssiLTE.SINR) f(value);
+    f(at.cerssiLTE.RI);
+    for (auto &value : at.cerssiLTE.CQI) f(value);
+    f(at.cerssiWCDMA.RSCP);
+    f(at.cerssiWCDMA.ECIO);
+    f(at.cerssiGSM.RSSI);
+    f(at.hcsqLTE.RSRP);
+    f(at.hcsqLTE.RSRQ);
+    f(at.hcsqLTE.RSSI);
+    f(at.hcsqLTE.SINR);
+    f(at.hcsqWCDMA.RSSI);
+    f(at.hcsqWCDMA.RSCP);
+    f(at.hcsqWCDMA.ECIO);
+    f(at.hcsqGSM.RSSI);
+    f(at.rssi.RSSILevel);
+}
+
+struct CountValues
+{
+    uint32_t count = 0;
+    void operator()(RadioValue &) { count++; }
+};
+
+// Both are specific to the build that wrote the checkpoint
+
+struct Layout
+{
+    uint32_t radioStateSize;
+    uint32_t durationStateSize;
+    uint32_t speedStateSize;
+    uint32_t numRadioValues;
+    uint32_t numAtValues;
+
+    bool operator==(const Layout &other) const
+    {
+        return !memcmp(this, &other, sizeof(*this));
+    }
+};
+
+Layout getLayout()
+{
+    CountValues radioValues, atValues;
+    RadioValues values;
+
+    forEachRadioValue(values, radioValues);
+    forEachAtValue(sig.at, atValues);
+
+    return {(uint32_t)sizeof(RadioValue::State), (uint32_t)sizeof(DurationValue::State),
+            (uint32_t)sizeof(SpeedValue::State), radioValues.count, atValues.count};
+}
+
+struct Out
+{
+    std::string buf;
+
+    template<typename T>
+    void put(const T &val)
+    {
+        buf.append((const char *)&val, sizeof(val));
+    }
+
+    void putStr(const std::string &str)
+    {
+        put((uint32_t)str.length());
+        buf += str;
+    }
+
+    template<typename T, bool IS_SPEED_VALUE>
+    void putValue(const SignalValue<T, IS_SPEED_VALUE> &value)
+    {
+        typename SignalValue<T, IS_SPEED_VALUE>::State state;
+        value.getState(state);
+        put(state);
+    }
+
+    // Monotonic times are stored as age
+    void putTime(const TimeType time)
+    {
+        put((uint64_t)(time ? getElapsedTime(time) : uint64_t(-1)));
+    }
+};
+
+// Parsed twice, once to validate the whole file and
+// once to apply it, a broken file never applies partially
+
+struct In
+{
+    const char *pos;
+    const char *end;
+    bool apply;
+    TimeType downtime;
+
+    template<typename T>
+    bool get(T &val)
+    {
+        if ((size_t)(end - pos) < sizeof(val)) return false;
+        memcpy(&val, pos, sizeof(val));
+        pos += sizeof(val);
+        return true;
+    }
+
+    bool getStr(std::string &str)
+    {
+        uint32_t length;
+        if (!get(length) || (size_t)(end - pos) < length) return false;
+        if (apply) str.assign(pos, length);
+        pos += length;
+        return true;
+    }
+
+    template<typename T, bool IS_SPEED_VALUE>
+    bool getValue(SignalValue<T, IS_SPEED_VALUE> &value)
+    {
+        typename SignalValue<T, IS_SPEED_VALUE>::State state;
+        if (!get(state)) return false;
+        if (apply) value.setState(state);
+        return true;
+    }
+
+    bool getTime(TimeType &time)
+    {
+        uint64_t age;
+        if (!get(age)) return false;
+        if (!apply) return true;
+        if (age == uint64_t(-1)) time = 0;
+        else if (age + downtime < now) time = now - age - downtime;
+        else time = 0;
+        return true;
+    }
+};
+
+void serialize(Out &out)
+{
+    using x::signal;
+
+    Layout layout = getLayout();
+
+    out.buf.append(MAGIC, MAGIC_LENGTH);
+    out.put(layout);
+    out.put((uint64_t)getUnixMilliSeconds());
+
+    // Signal
+
+    forEachRadioValue(signal, [&](const RadioValue &value) { out.putValue(value); });
+    forEachAtValue(signal.at, [&](const RadioValue &value) { out.putValue(value); });
+
+    for (const XMLNumType val : {signal.band, signal.cell, signal.DLBW, signal.UPBW,
+                                 signal.mode, signal.networkTypeEx, signal.PLMN})
+    {
+        out.put(val);
+    }
+
+    out.putStr(signal.operatorName);
+    out.putStr(signal.operatorNameShort);
+
+    out.put((uint8_t)signal.connStatus.down);
+    out.put((uint64_t)signal.connStatus.downDuration);
+    out.put((uint64_t)signal.connStatus.count);
+
+    // Cells
+
+    out.put((uint32_t)cells::index.size());
+
+    for (auto &it : cells::index)
+    {
+        CellStats &stats = it.second;
+
+        out.put(it.first);
+        out.putTime(stats.firstSeen);
+        out.putTime(stats.lastSeen);
+        out.put((uint64_t)stats.visits);
+        forEachRadioValue(stats, [&](const RadioValue &value) { out.putValue(value); });
+    }
+
+    // Traffic
+
+    for (const TrafficStats *stats : {&traffic.current, &traffic.monthly, &traffic.total})
+    {
+        out.putValue(stats->CD);
+        out.putValue(stats->DL);
+        out.putValue(stats->UP);
+    }
+}
+
+bool deserialize(In &in)
+{
+    using x::signal;
+
+    Layout layout;
+    uint64_t time;
+    bool ok = true;
+
+    if ((size_t)(in.end - in.pos) < MAGIC_LENGTH || memcmp(in.pos, MAGIC, MAGIC_LENGTH)) return false;
+    in.pos += MAGIC_LENGTH;
+
+    if ((size_t)(in.end - in.pos) < sizeof(layout) + sizeof(time)) return false;
+
+    memcpy(&layout, in.pos, sizeof(layout));
+    memcpy(&time, in.pos + sizeof(layout), sizeof(time));
+    in.pos += sizeof(layout) + sizeof(time);
+
+    if (!(layout == getLayout())) return false;
+
+    const unsigned long long unixTime = getUnixMilliSeconds();
+    in.downtime = unixTime > time ? unixTime - time : 0;
+
+    // Signal
+
+    forEachRadioValue(signal, [&](RadioValue &value) { ok = ok && in.getValue(value); });
+    forEachAtValue(signal.at, [&](RadioValue &value) { ok = ok && in.getValue(value); });
+
+    for (XMLNumType *val : {&signal.band, &signal.cell, &signal.DLBW, &signal.UPBW,
+                            &signal.mode, &signal.networkTypeEx, &signal.PLMN})
+    {
+        XMLNumType tmp;
+        ok = ok && in.get(tmp);
+        if (ok && in.apply) *val = tmp;
+    }
+
+    ok = ok && in.getStr(signal.operatorName) && in.getStr(signal.operatorNameShort);
+
+    uint8_t down;
+    uint64_t downDuration, count;
+
+    if (!ok || !in.get(down) || !in.get(downDuration) || !in.get(count)) return false;
+
+    if (in.apply)
+    {
+        signal.connStatus.down = down;
+        signal.connStatus.downDuration = downDuration;
+        signal.connStatus.count = count;
+        signal.connStatus.firstDown = down ? now : 0;
+    }
+
+    // Cells
+
+    uint32_t numCells;
+    if (!in.get(numCells)) return false;
+
+    CellStats dummy;
+
+    for (uint32_t i = 0; i < numCells; i++)
+    {
+        CellKey key;
+        uint64_t visits = 0;
+
+        if (!in.get(key)) return false;
+
+        CellStats &stats = in.apply ? cells::index[key] : dummy;
+
+        if (!in.getTime(stats.firstSeen) || !in.getTime(stats.lastSeen) || !in.get(visits))
+            return false;
+
+        if (in.apply) stats.visits = visits;
+
+        forEachRadioValue(stats, [&](RadioValue &value) { ok = ok && in.getValue(value); });
+        if (!ok) return false;
+    }
+
+    // Traffic
+
+    for (TrafficStats *stats : {&traffic.current, &traffic.monthly, &traffic.total})
+        ok = ok && in.getValue(stats->CD) && in.getValue(stats->DL) && in.getValue(stats->UP);
+
+    return ok && in.pos == in.end;
+}
+
+bool writeFile(const std::string &path, const std::string &buf)
+{
+    const std::string tmpPath = path + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "wb");
+
+    if (!file)
+    {
+        err.linef("Could not write %s", tmpPath.c_str());
+        return false;
+    }
+
+    bool ok = fwrite(buf.data(), 1, buf.length(), file) == buf.length() && !fflush(file);
+
+#ifdef _WIN32
+    ok = ok && !_commit(_fileno(file));
+#else
+    ok = ok && !fsync(fileno(file));
+#endif
+
+    ok = !fclose(file) && ok;
+
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows
+    if (ok) remove(path.c_str());
+#endif
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()))
+    {
+        err.linef("Could not write %s", path.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void joinWriter()
+{
+    if (writer.joinable()) writer.join();
+}
+
+} // anonymous namespace
+
+bool restore(const char *path_)
+{
+    activePath = path_;
+    updateTime();
+    lastWrite = now;
+
+    FILE *file = fopen(path_, "rb");
+
+    if (!file)
+    {
+        dbg.linef("No checkpoint at %s", path_);
+        return true;
+    }
+
+    std::string buf;
+    char tmp[64 * 1024];
+    size_t length;
+
+    while ((length = fread(tmp, 1, sizeof(tmp), file)) > 0) buf.append(tmp, length);
+    fclose(file);
+
+    In in = {buf.data(), buf.data() + buf.length(), false, 0};
+
+    if (!deserialize(in))
+    {
+        warn.linef("Ignoring invalid or outdated checkpoint %s", path_);
+        return true;
+    }
+
+    in = {buf.data(), buf.data() + buf.length(), true, 0};
+    deserialize(in);
+
+    // Written with a higher limit
+    cells::prune();
+
+    dbg.linef("Restored checkpoint %s (%zu cells)", path_, cells::index.size());
+
+    return true;
+}
+
+void update()
+{
+    if (activePath.empty() || interval <= 0) return;
+    if (!timeElapsedGE(lastWrite, interval * oneSecond)) return;
+
+    lastWrite = now;
+
+    // Serializing takes microseconds, the
+    // disk write happens in the background.
+
+    std::shared_ptr<Out> out = std::make_shared<Out>();
+    serialize(*out);
+
+    joinWriter();
+
+    const std::string path = activePath;
+    writer = std::thread([out, path]() { writeFile(path, out->buf); });
+}
+
+bool write()
+{
+    if (activePath.empty()) return false;
+
+    Out out;
+    serialize(out);
+
+    joinWriter();
+    return writeFile(activePath, out.buf);
+}
+
+void close()
+{
+    if (activePath.empty()) return;
+
+    write();
+    activePath.clear();
+}
+
+} // namespace checkpoint
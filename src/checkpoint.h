@@ -0,0 +1,44 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+/*
+ * Periodic binary checkpoints of the accumulated statistics: every
+ * signal value, the per-cell statistics and the traffic counters.
+ * Restored at startup so long running statistics survive restarts.
+ *
+ * The file is replaced atomically (written to <path>.tmp, then renamed)
+ * and is only valid for the build that wrote it, a checkpoint with a
+ * different layout is ignored.
+ */
+
+namespace checkpoint {
+
+extern char path[256];
+extern int interval; // Seconds
+
+bool restore(const char *path);
+void update(); // Writes a checkpoint once the interval has passed
+bool write();
+void close();  // Writes a final checkpoint
+
+} // namespace checkpoint
+
+#endif // __CHECKPOINT_H__
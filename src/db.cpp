@@ -0,0 +1,535 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "db.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+#include "web.h"
+#include "events.h"
+
+namespace db {
+
+char path[256] = "";
+int batchSize = 500;
+int batchInterval = 10;
+int rawRetention = 0;
+
+} // namespace db
+
+#ifdef USE_SQLITE
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <sqlite3.h>
+
+namespace db {
+
+namespace {
+
+struct SampleRow
+{
+    TimeType time;
+    const char *name; // Metric names are string literals
+    double val;
+};
+
+struct RollupRow
+{
+    const char *name;
+    TimeType interval;
+    RollupTier::Bucket bucket;
+};
+
+struct WlanRow
+{
+    std::string ssid;
+    std::string mac;
+    std::string ip;
+    std::string host;
+    TimeType start;
+    TimeType end;
+};
+
+struct WlanSession
+{
+    TimeType start;
+    bool referenced;
+};
+
+sqlite3 *handle = nullptr;
+sqlite3_stmt *insertMetric = nullptr;
+sqlite3_stmt *selectMetric = nullptr;
+sqlite3_stmt *insertSample = nullptr;
+sqlite3_stmt *upsertWlanSession = nullptr;
+sqlite3_stmt *upsertRollup = nullptr;
+sqlite3_stmt *insertEvent = nullptr;
+sqlite3_stmt *pruneSamples = nullptr;
+sqlite3_stmt *pruneRollups = nullptr;
+
+// Main thread only
+std::map<const char *, size_t> lastCounts;
+unsigned long long eventCursor = 0;
+std::map<std::string, WlanSession> wlanSessions;
+
+// Shared with the writer thread
+std::vector<SampleRow> pendingSamples;
+std::vector<RollupRow> pendingRollups;
+std::vector<RollupTier::Bucket> closedBuckets; // Reused by record()
+std::vector<events::Event> pendingEvents;
+std::vector<WlanRow> pendingWlan;
+std::mutex mutex;
+std::condition_variable cond;
+std::thread writer;
+bool stop = false;
+
+constexpr const char *SCHEMA =
+    "PRAGMA journal_mode=WAL;"
+    "PRAGMA synchronous=NORMAL;"
+    "CREATE TABLE IF NOT EXISTS metrics ("
+    "  id INTEGER PRIMARY KEY,"
+    "  name TEXT NOT NULL UNIQUE);"
+    "CREATE TABLE IF NOT EXISTS samples ("
+    "  time INTEGER NOT NULL,"
+    "  metric INTEGER NOT NULL REFERENCES metrics(id),"
+    "  value REAL NOT NULL);"
+    "CREATE INDEX IF NOT EXISTS samples_metric_time ON samples(metric, time);"
+    "CREATE TABLE IF NOT EXISTS wlan_sessions ("
+    "  ssid TEXT NOT NULL,"
+    "  mac TEXT NOT NULL,"
+    "  ip TEXT,"
+    "  host TEXT,"
+    "  start INTEGER NOT NULL,"
+    "  end INTEGER NOT NULL,"
+    "  UNIQUE(ssid, mac, start));"
+    "CREATE TABLE IF NOT EXISTS rollups ("
+    "  interval INTEGER NOT NULL,"
+    "  start INTEGER NOT NULL,"
+    "  metric INTEGER NOT NULL REFERENCES metrics(id),"
+    "  count INTEGER NOT NULL,"
+    "  min REAL NOT NULL,"
+    "  max REAL NOT NULL,"
+    "  mean REAL NOT NULL,"
+    "  p5 REAL NOT NULL,"
+    "  median REAL NOT NULL,"
+    "  p95 REAL NOT NULL,"
+    "  UNIQUE(interval, metric, start));"
+    "CREATE TABLE IF NOT EXISTS events ("
+    "  time INTEGER NOT NULL,"
+    "  type TEXT NOT NULL,"
+    "  before INTEGER NOT NULL,"
+    "  after INTEGER NOT NULL);"
+    "CREATE VIEW IF NOT EXISTS rollups_view AS"
+    "  SELECT rollups.interval, rollups.start, metrics.name, rollups.count,"
+    "         rollups.min, rollups.max, rollups.mean,"
+    "         rollups.p5, rollups.median, rollups.p95"
+    "  FROM rollups JOIN metrics ON metrics.id = rollups.metric;"
+    "CREATE VIEW IF NOT EXISTS samples_view AS"
+    "  SELECT samples.time, metrics.name, samples.value"
+    "  FROM samples JOIN metrics ON metrics.id = samples.metric;";
+
+bool exec(const char *sql)
+{
+    char *errmsg = nullptr;
+
+    if (sqlite3_exec(handle, sql, nullptr, nullptr, &errmsg) != SQLITE_OK)
+    {
+        errfunf("%s", errmsg ? errmsg : sqlite3_errmsg(handle));
+        sqlite3_free(errmsg);
+        return false;
+    }
+
+    return true;
+}
+
+bool prepare(const char *sql, sqlite3_stmt *&stmt)
+{
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        errfunf("%s", sqlite3_errmsg(handle));
+        return false;
+    }
+
+    return true;
+}
+
+bool step(sqlite3_stmt *stmt)
+{
+    const int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW)
+    {
+        errfunf_once("%s", sqlite3_errmsg(handle));
+        return false;
+    }
+
+    return true;
+}
+
+void bindText(sqlite3_stmt *stmt, const int index, const std::string &str)
+{
+    sqlite3_bind_text(stmt, index, str.c_str(), str.length(), SQLITE_TRANSIENT);
+}
+
+sqlite3_int64 getMetricId(const char *name)
+{
+    static std::map<const char *, sqlite3_int64> ids;
+
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+
+    sqlite3_bind_text(insertMetric, 1, name, -1, SQLITE_STATIC);
+    step(insertMetric);
+
+    sqlite3_int64 id = -1;
+    sqlite3_bind_text(selectMetric, 1, name, -1, SQLITE_STATIC);
+    if (sqlite3_step(selectMetric) == SQLITE_ROW) id = sqlite3_column_int64(selectMetric, 0);
+    sqlite3_reset(selectMetric);
+    sqlite3_clear_bindings(selectMetric);
+
+    ids[name] = id;
+    return id;
+}
+
+void prune()
+{
+    // Every rollup tier is kept as long as its retention,
+    // raw samples are kept for rawRetention days.
+
+    const TimeType time = getUnixMilliSeconds();
+
+    if (rawRetention > 0)
+    {
+        sqlite3_bind_int64(pruneSamples, 1, time - rawRetention * oneDay);
+        step(pruneSamples);
+    }
+
+    for (size_t i = 0; i < rollup_tiers::count; i++)
+    {
+        const rollup_tiers::Tier &tier = rollup_tiers::tiers[i];
+        sqlite3_bind_int64(pruneRollups, 1, tier.interval);
+        sqlite3_bind_int64(pruneRollups, 2, time - tier.interval * tier.retention);
+        step(pruneRollups);
+    }
+}
+
+void write(const std::vector<SampleRow> &samples, const std::vector<RollupRow> &rollups,
+           const std::vector<events::Event> &events, const std::vector<WlanRow> &wlan)
+{
+    static TimeType lastPrune = 0;
+
+    if (!exec("BEGIN")) return;
+
+    for (auto &row : samples)
+    {
+        sqlite3_bind_int64(insertSample, 1, row.time);
+        sqlite3_bind_int64(insertSample, 2, getMetricId(row.name));
+        sqlite3_bind_double(insertSample, 3, row.val);
+        step(insertSample);
+    }
+
+    for (auto &row : rollups)
+    {
+        const RollupTier::Bucket &bucket = row.bucket;
+
+        sqlite3_bind_int64(upsertRollup, 1, row.interval);
+        sqlite3_bind_int64(upsertRollup, 2, bucket.start);
+        sqlite3_bind_int64(upsertRollup, 3, getMetricId(row.name));
+        sqlite3_bind_int64(upsertRollup, 4, bucket.count);
+        sqlite3_bind_double(upsertRollup, 5, bucket.min);
+        sqlite3_bind_double(upsertRollup, 6, bucket.max);
+        sqlite3_bind_double(upsertRollup, 7, bucket.mean);
+        sqlite3_bind_double(upsertRollup, 8, bucket.p5);
+        sqlite3_bind_double(upsertRollup, 9, bucket.median);
+        sqlite3_bind_double(upsertRollup, 10, bucket.p95);
+        step(upsertRollup);
+    }
+
+    for (auto &event : events)
+    {
+        sqlite3_bind_int64(insertEvent, 1, event.time);
+        sqlite3_bind_text(insertEvent, 2, events::getTypeStr(event.type), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(insertEvent, 3, event.before);
+        sqlite3_bind_int64(insertEvent, 4, event.after);
+        step(insertEvent);
+    }
+
+    for (auto &row : wlan)
+    {
+        bindText(upsertWlanSession, 1, row.ssid);
+        bindText(upsertWlanSession, 2, row.mac);
+        bindText(upsertWlanSession, 3, row.ip);
+        bindText(upsertWlanSession, 4, row.host);
+        sqlite3_bind_int64(upsertWlanSession, 5, row.start);
+        sqlite3_bind_int64(upsertWlanSession, 6, row.end);
+        step(upsertWlanSession);
+    }
+
+    if (!lastPrune || getUnixMilliSeconds() - lastPrune >= oneHour)
+    {
+        prune();
+        lastPrune = getUnixMilliSeconds();
+    }
+
+    exec("COMMIT");
+}
+
+void writerThread()
+{
+    std::vector<SampleRow> samples;
+    std::vector<RollupRow> rollups;
+    std::vector<events::Event> events;
+    std::vector<WlanRow> wlan;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            cond.wait_for(lock, std::chrono::seconds(batchInterval), []
+            {
+                return stop || pendingSamples.size() >= (size_t)batchSize;
+            });
+
+            samples.swap(pendingSamples);
+            rollups.swap(pendingRollups);
+            events.swap(pendingEvents);
+            wlan.swap(pendingWlan);
+        }
+
+        if (!samples.empty() || !rollups.empty() || !events.empty() || !wlan.empty())
+            write(samples, rollups, events, wlan);
+
+        samples.clear();
+        rollups.clear();
+        events.clear();
+        wlan.clear();
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (stop && pendingSamples.empty() && pendingRollups.empty() &&
+            pendingEvents.empty() && pendingWlan.empty())
+        {
+            break;
+        }
+    }
+}
+
+void notifyWriter()
+{
+    cond.notify_one();
+}
+
+} // anonymous namespace
+
+bool open(const char *path_)
+{
+    if (handle) close();
+
+    if (sqlite3_open(path_, &handle) != SQLITE_OK)
+    {
+        err.linef("Could not open %s: %s", path_, sqlite3_errmsg(handle));
+        sqlite3_close(handle);
+        handle = nullptr;
+        return false;
+    }
+
+    if (!exec(SCHEMA) ||
+        !prepare("INSERT OR IGNORE INTO metrics(name) VALUES(?)", insertMetric) ||
+        !prepare("SELECT id FROM metrics WHERE name = ?", selectMetric) ||
+        !prepare("INSERT INTO samples(time, metric, value) VALUES(?, ?, ?)", insertSample) ||
+        !prepare("INSERT INTO wlan_sessions(ssid, mac, ip, host, start, end) "
+                 "VALUES(?, ?, ?, ?, ?, ?) "
+                 "ON CONFLICT(ssid, mac, start) DO UPDATE SET "
+                 "ip = excluded.ip, host = excluded.host, end = excluded.end",
+                 upsertWlanSession) ||
+        !prepare("INSERT OR REPLACE INTO rollups(interval, start, metric, count, "
+                 "min, max, mean, p5, median, p95) VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                 upsertRollup) ||
+        !prepare("DELETE FROM samples WHERE metric IN (SELECT id FROM metrics) AND time < ?",
+                 pruneSamples) ||
+        !prepare("DELETE FROM rollups WHERE interval = ? AND start < ?", pruneRollups) ||
+        !prepare("INSERT INTO events(time, type, before, after) VALUES(?, ?, ?, ?)",
+                 insertEvent))
+    {
+        close();
+        return false;
+    }
+
+    // A zero interval or batch size would wake the writer thread in a loop
+
+    if (batchInterval < 1)
+    {
+        warn.linef("db_batch_interval must be at least 1 second, using 1");
+        batchInterval = 1;
+    }
+
+    if (batchSize < 1)
+    {
+        warn.linef("db_batch_size must be at least 1, using 1");
+        batchSize = 1;
+    }
+
+    copystr(path, path_);
+    stop = false;
+    writer = std::thread(writerThread);
+
+    return true;
+}
+
+void record()
+{
+    if (!handle) return;
+
+    const TimeType time = getUnixMilliSeconds();
+    bool wakeup = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        forEachMetric([&](const Metric &metric)
+        {
+            if (!metric.count) return;
+
+            // SignalValue::update() only counts changed values
+            size_t &lastCount = lastCounts[metric.name];
+            if (lastCount == metric.count) return;
+            lastCount = metric.count;
+
+            pendingSamples.push_back({time, metric.name, metric.val});
+        });
+
+        forEachMetric([&](const Metric &metric)
+        {
+            if (!metric.rollups) return;
+
+            for (size_t i = 0; i < rollup_tiers::count; i++)
+            {
+                closedBuckets.clear();
+                metric.rollups[i].takeClosed(closedBuckets);
+
+                for (const RollupTier::Bucket &bucket : closedBuckets)
+                    pendingRollups.push_back({metric.name, rollup_tiers::tiers[i].interval, bucket});
+            }
+        });
+
+        events::forEachSince(eventCursor, [&](const events::Event &event)
+        {
+            pendingEvents.push_back(event);
+            return true;
+        });
+
+        wakeup = pendingSamples.size() >= (size_t)batchSize;
+    }
+
+    if (wakeup) notifyWriter();
+}
+
+void recordWlanClients()
+{
+    if (!handle) return;
+
+    const TimeType time = getUnixMilliSeconds();
+
+    for (auto &it : wlanSessions) it.second.referenced = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto &it : web::wlan::ssids)
+        {
+            const std::string &ssid = it.first;
+
+            for (auto &client : *it.second.clients)
+            {
+                // The start time is fixed when the client shows up, otherwise
+                // AssociatedTime jitter would split the session into many rows.
+
+                auto session = wlanSessions.find(ssid + client.macAddress);
+
+                if (session == wlanSessions.end())
+                {
+                    const TimeType start = time - client.connectionDuration * oneSecond;
+                    session = wlanSessions.insert({ssid + client.macAddress, {start, true}}).first;
+                }
+
+                session->second.referenced = true;
+
+                pendingWlan.push_back({ssid, client.macAddress, client.ipAddress,
+                                       client.hostName, session->second.start, time});
+            }
+        }
+    }
+
+    for (auto it = wlanSessions.begin(); it != wlanSessions.end();)
+    {
+        if (!it->second.referenced) it = wlanSessions.erase(it);
+        else ++it;
+    }
+}
+
+void close()
+{
+    if (!handle) return;
+
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+
+        notifyWriter();
+        writer.join();
+    }
+
+    for (auto *stmt : {insertMetric, selectMetric, insertSample, upsertWlanSession,
+                       upsertRollup, pruneSamples, pruneRollups, insertEvent})
+        sqlite3_finalize(stmt);
+
+    insertMetric = selectMetric = insertSample = upsertWlanSession = nullptr;
+    upsertRollup = pruneSamples = pruneRollups = insertEvent = nullptr;
+
+    sqlite3_close(handle);
+    handle = nullptr;
+    lastCounts.clear();
+    wlanSessions.clear();
+}
+
+} // namespace db
+
+#else
+
+namespace db {
+
+bool open(const char *)
+{
+    err.linef("Built without SQLite support");
+    return false;
+}
+
+void record() {}
+void recordWlanClients() {}
+void close() {}
+
+} // namespace db
+
+#endif // USE_SQLITE
@@ -0,0 +1,53 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __DB_H__
+#define __DB_H__
+
+/*
+ * SQLite sink for signal values, traffic counters and WLAN client
+ * sessions. Rows are queued and written by a background thread in
+ * one transaction per batch.
+ *
+ * Tables: metrics(id, name), samples(time, metric, value),
+ *         rollups(interval, start, metric, count, min, max, mean, p5, median, p95),
+ *         events(time, type, before, after),
+ *         wlan_sessions(ssid, mac, ip, host, start, end)
+ * Views:  samples_view(time, name, value), rollups_view
+ *
+ * Closed rollup buckets are written as they close and pruned with
+ * the retention of their tier, samples after rawRetention days.
+ *
+ * Times are Unix timestamps in milliseconds.
+ */
+
+namespace db {
+
+extern char path[256];
+extern int batchSize;     // Rows
+extern int batchInterval; // Seconds
+extern int rawRetention;  // Days, 0 keeps samples forever
+
+bool open(const char *path);
+void record();
+void recordWlanClients();
+void close();
+
+} // namespace db
+
+#endif // __DB_H__
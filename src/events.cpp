@@ -0,0 +1,113 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "events.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+
+namespace events {
+
+namespace {
+
+constexpr const char *typeStrs[] =
+{
+    "cell", "band", "mode", "network_type", "plmn", "connection"
+};
+
+constexpr const char *seriesNames[] =
+{
+    "event_cell", "event_band", "event_mode",
+    "event_network_type", "event_plmn", "event_connection"
+};
+
+static_assert(sizeof(typeStrs) / sizeof(*typeStrs) == NUM_TYPES, "");
+static_assert(sizeof(seriesNames) / sizeof(*seriesNames) == NUM_TYPES, "");
+
+std::deque<Event> recent;
+unsigned long long nextSeq = 0;
+size_t counts[NUM_TYPES];
+
+XMLNumType last[NUM_TYPES];
+bool known[NUM_TYPES];
+
+} // anonymous namespace
+
+const char *getTypeStr(const Type type)
+{
+    return typeStrs[type];
+}
+
+const char *getSeriesName(const Type type)
+{
+    return seriesNames[type];
+}
+
+void detect()
+{
+    // Avoid name clash with ::signal
+    using x::signal;
+
+    const XMLNumType vals[NUM_TYPES] =
+    {
+        signal.cell,
+        signal.band,
+        signal.mode,
+        signal.networkTypeEx,
+        signal.PLMN,
+        signal.connStatus.isSet() ? XMLNumType(!signal.connStatus.isDown()) : __XML_NUM_ERROR__
+    };
+
+    const TimeType time = getUnixMilliSeconds();
+
+    for (int type = 0; type < NUM_TYPES; type++)
+    {
+        const XMLNumType val = vals[type];
+
+        // Failed requests are no change
+        if (val == __XML_NUM_ERROR__) continue;
+
+        if (!known[type])
+        {
+            last[type] = val;
+            known[type] = true;
+            continue;
+        }
+
+        if (val == last[type]) continue;
+
+        dbg.linef("Event: %s %llu -> %llu", typeStrs[type], last[type], val);
+
+        if (recent.size() == MAX_EVENTS) recent.pop_front();
+        recent.push_back({nextSeq++, (Type)type, time, last[type], val});
+        counts[type]++;
+
+        last[type] = val;
+    }
+}
+
+const std::deque<Event> &getRecent()
+{
+    return recent;
+}
+
+size_t getCount(const Type type)
+{
+    return counts[type];
+}
+
+} // namespace events
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __EVENTS_H__
+#define __EVENTS_H__
+
+#include "tools.h"
+
+#include <deque>
+
+/*
+ * Radio events: serving cell, band, mode, network type or PLMN
+ * changes and connection drops, detected after every signal update.
+ *
+ * Every sink keeps its own cursor and picks up the events it
+ * hasn't seen yet with forEachSince().
+ */
+
+namespace events {
+
+enum Type : int
+{
+    CELL,
+    BAND,
+    MODE,
+    NETWORK_TYPE,
+    PLMN,
+    CONNECTION, // 1 = Connected, 0 = Down
+    NUM_TYPES
+};
+
+struct Event
+{
+    unsigned long long seq;
+    Type type;
+    TimeType time; // Unix time in milliseconds
+    XMLNumType before;
+    XMLNumType after;
+};
+
+constexpr size_t MAX_EVENTS = 64;
+
+const char *getTypeStr(const Type type);
+const char *getSeriesName(const Type type); // "event_<type>"
+
+void detect();
+
+const std::deque<Event> &getRecent();
+size_t getCount(const Type type);
+
+// f returns false to stop, the cursor then stays at the event it
+// didn't take so that it is passed again next time
+template<typename F>
+void forEachSince(unsigned long long &cursor, F &&f)
+{
+    for (const Event &event : getRecent())
+    {
+        if (event.seq < cursor) continue;
+        if (!f(event)) return;
+        cursor = event.seq + 1;
+    }
+}
+
+} // namespace events
+
+#endif // __EVENTS_H__
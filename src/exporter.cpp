@@ -0,0 +1,352 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "exporter.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+#include "web.h"
+#include "events.h"
+#include "net.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace exporter {
+
+int port = 0;
+
+namespace {
+
+constexpr const char *CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+constexpr unsigned REQUEST_TIMEOUT = 2000;
+
+net::Socket server = net::INVALID_SOCK;
+std::thread listener;
+std::atomic<bool> stopListener{false};
+std::atomic<unsigned long long> scrapes{0};
+
+std::mutex pageMutex;
+std::shared_ptr<const std::string> page;
+
+bool isSet(const XMLNumType val)
+{
+    return val && val != __XML_NUM_ERROR__;
+}
+
+void addLabel(StrBuf &str, const char *name, const std::string &val)
+{
+    if (str.back() != '{') str += ',';
+    str.format("%s=\"", name);
+
+    for (const char c : val)
+    {
+        switch (c)
+        {
+            case '\\': str += "\\\\"; break;
+            case '"': str += "\\\""; break;
+            case '\n': str += "\\n"; break;
+            default: str += c;
+        }
+    }
+
+    str += '"';
+}
+
+void addTraffic(StrBuf &str, const char *family, const char *suffix, const double val,
+                const char *period)
+{
+    str.format("%s%s{period=\"%s\"} %.15g\n", family, suffix, period, val);
+}
+
+void renderSignal(StrBuf &str)
+{
+    using x::signal;
+
+    forEachMetric([&](const Metric &metric)
+    {
+        if (!metric.count || !strncmp(metric.name, "traffic_", 8)) return;
+
+        str.format("# TYPE huawei_%s gauge\n", metric.name);
+        str.format("huawei_%s %g\n", metric.name, metric.val);
+    });
+
+    if (!isSet(signal.band) && !isSet(signal.cell)) return;
+
+    str += "# TYPE huawei_cell info\n";
+    str += "huawei_cell_info{";
+
+    StrBuf val;
+
+    auto addNumLabel = [&](const char *name, const XMLNumType num, const char *fmt)
+    {
+        if (!isSet(num)) return;
+        val.clear();
+        val.format(fmt, num);
+        addLabel(str, name, val);
+    };
+
+    addNumLabel("plmn", signal.PLMN, "%llu");
+    addNumLabel("mode", signal.mode, "%llu");
+    addNumLabel("network_type", signal.networkTypeEx, "%llu");
+    addNumLabel("band", signal.band, "%llu");
+    addNumLabel("cell", signal.cell, "%llX");
+    if (!signal.operatorName.empty()) addLabel(str, "operator", signal.operatorName);
+
+    str += "} 1\n";
+
+    if (isSet(signal.band))
+    {
+        str += "# TYPE huawei_band gauge\n";
+        str.format("huawei_band %llu\n", signal.band);
+    }
+
+    if (isSet(signal.DLBW))
+    {
+        str += "# TYPE huawei_dl_bandwidth gauge\n";
+        str.format("huawei_dl_bandwidth %llu\n", signal.DLBW);
+    }
+
+    if (isSet(signal.UPBW))
+    {
+        str += "# TYPE huawei_ul_bandwidth gauge\n";
+        str.format("huawei_ul_bandwidth %llu\n", signal.UPBW);
+    }
+}
+
+void renderTraffic(StrBuf &str)
+{
+    const std::pair<const char *, const TrafficStats *> periods[] =
+    {
+        {"current", &traffic.current},
+        {"monthly", &traffic.monthly},
+        {"total", &traffic.total}
+    };
+
+    bool haveTraffic = false;
+    for (auto &period : periods) haveTraffic |= period.second->CD.isSet();
+    if (!haveTraffic) return;
+
+    str += "# TYPE huawei_traffic_duration_seconds gauge\n";
+    str += "# UNIT huawei_traffic_duration_seconds seconds\n";
+
+    for (auto &period : periods)
+        if (period.second->CD.isSet())
+            addTraffic(str, "huawei_traffic_duration_seconds", "",
+                       *period.second->CD.current, period.first);
+
+    str += "# TYPE huawei_traffic_download_bytes counter\n";
+    str += "# UNIT huawei_traffic_download_bytes bytes\n";
+
+    for (auto &period : periods)
+        if (period.second->DL.isSet())
+            addTraffic(str, "huawei_traffic_download_bytes", "_total",
+                       *period.second->DL.current, period.first);
+
+    str += "# TYPE huawei_traffic_upload_bytes counter\n";
+    str += "# UNIT huawei_traffic_upload_bytes bytes\n";
+
+    for (auto &period : periods)
+        if (period.second->UP.isSet())
+            addTraffic(str, "huawei_traffic_upload_bytes", "_total",
+                       *period.second->UP.current, period.first);
+}
+
+void renderWlanClients(StrBuf &str)
+{
+    if (web::wlan::ssids.empty()) return;
+
+    str += "# TYPE huawei_wlan_clients gauge\n";
+
+    for (auto &it : web::wlan::ssids)
+    {
+        str += "huawei_wlan_clients{";
+        addLabel(str, "ssid", it.first);
+        str.format("} %zu\n", it.second.clients->size());
+    }
+}
+
+std::shared_ptr<const std::string> getPage()
+{
+    std::lock_guard<std::mutex> lock(pageMutex);
+    return page;
+}
+
+bool send(net::Socket client, const std::string &data, const TimeType deadline)
+{
+    const TimeType time = getMilliSeconds();
+    if (time >= deadline) return false;
+
+    return net::sendAll(client, data.c_str(), data.length(), unsigned(deadline - time));
+}
+
+void serve(net::Socket client)
+{
+    // Only the request line matters, the rest of the header is drained
+    // until the blank line so the client sees a clean response. Clients
+    // are served one at a time, so the whole request and response share
+    // one deadline, a client trickling bytes can't hold the listener.
+
+    const TimeType deadline = getMilliSeconds() + REQUEST_TIMEOUT;
+    char request[4096];
+    size_t length = 0;
+
+    while (length < sizeof(request) - 1)
+    {
+        const TimeType time = getMilliSeconds();
+        if (time >= deadline) break;
+
+        if (net::waitReadable(client, unsigned(deadline - time)) <= 0) break;
+
+        const long recvLength = net::recv(client, request + length,
+                                          sizeof(request) - 1 - length);
+        if (recvLength < 0) break;
+
+        length += recvLength;
+        request[length] = '\0';
+
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+
+    request[length] = '\0';
+
+    StrBuf header;
+    std::shared_ptr<const std::string> body;
+
+    const bool isGet = !strncmp(request, "GET ", 4);
+    const char *target = request + 4;
+
+    if (isGet && (!strncmp(target, "/metrics ", 9) || !strncmp(target, "/ ", 2)))
+    {
+        body = getPage();
+        scrapes++;
+
+        if (!body)
+        {
+            header += "HTTP/1.0 503 Service Unavailable\r\n"
+                     "Content-Length: 0\r\n"
+                     "Connection: close\r\n\r\n";
+        }
+        else
+        {
+            header.format("HTTP/1.0 200 OK\r\n"
+                          "Content-Type: %s\r\n"
+                          "Content-Length: %zu\r\n"
+                          "Connection: close\r\n\r\n",
+                          CONTENT_TYPE, body->length());
+        }
+    }
+    else
+    {
+        header += isGet ? "HTTP/1.0 404 Not Found\r\n" : "HTTP/1.0 405 Method Not Allowed\r\n";
+        header += "Content-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+
+    if (send(client, header, deadline) && body)
+        send(client, *body, deadline);
+}
+
+void listenerThread()
+{
+    while (!stopListener)
+    {
+        if (net::waitReadable(server, 250) <= 0) continue;
+
+        net::Socket client = net::accept(server);
+        if (client == net::INVALID_SOCK) continue;
+
+        serve(client);
+        net::close(client);
+    }
+}
+
+} // anonymous namespace
+
+bool start(const int port_)
+{
+    if (server != net::INVALID_SOCK) stop();
+
+    if (!net::init())
+    {
+        errfunf("%s", net::getError());
+        return false;
+    }
+
+    if ((server = net::listen(port_)) == net::INVALID_SOCK)
+    {
+        dbg.linef("%s", net::getError());
+        err.linef("Could not listen on port %d", port_);
+        net::deinit();
+        return false;
+    }
+
+    port = port_;
+    stopListener = false;
+    listener = std::thread(listenerThread);
+
+    dbg.linef("Exporter listening on port %d", port);
+
+    return true;
+}
+
+void update()
+{
+    if (server == net::INVALID_SOCK) return;
+
+    StrBuf str;
+
+    renderSignal(str);
+    renderTraffic(str);
+    renderWlanClients(str);
+
+    str += "# TYPE huawei_events counter\n";
+    for (int type = 0; type < events::NUM_TYPES; type++)
+    {
+        str.format("huawei_events_total{type=\"%s\"} %zu\n",
+                   events::getTypeStr((events::Type)type), events::getCount((events::Type)type));
+    }
+
+
+    str += "# TYPE huawei_exporter_scrapes counter\n";
+    str.format("huawei_exporter_scrapes_total %llu\n", scrapes.load());
+    str += "# TYPE huawei_last_update_timestamp_seconds gauge\n";
+    str.format("huawei_last_update_timestamp_seconds %.3f\n", getUnixMilliSeconds() / 1000.0);
+    str += "# EOF\n";
+
+    std::shared_ptr<const std::string> newPage = std::make_shared<const std::string>(std::move(str));
+
+    std::lock_guard<std::mutex> lock(pageMutex);
+    page.swap(newPage);
+}
+
+void stop()
+{
+    if (server == net::INVALID_SOCK) return;
+
+    stopListener = true;
+    if (listener.joinable()) listener.join();
+
+    net::close(server);
+    net::deinit();
+
+    std::lock_guard<std::mutex> lock(pageMutex);
+    page.reset();
+}
+
+} // namespace exporter
@@ -0,0 +1,40 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __EXPORTER_H__
+#define __EXPORTER_H__
+
+/*
+ * OpenMetrics (Prometheus) exporter.
+ *
+ * update() renders the in-memory signal, traffic and WLAN state once
+ * per new sample. A listener thread hands that page to every scraper,
+ * so scrapes never cause router requests.
+ */
+
+namespace exporter {
+
+extern int port;
+
+bool start(const int port);
+void update();
+void stop();
+
+} // namespace exporter
+
+#endif // __EXPORTER_H__
@@ -25,16 +25,37 @@ template<>
 const char *const SignalValue<>::getTypeStrs[] =
 {
     "Current", "Min", "Worst", "Max", "Best", "First",
-    "Previous", "Average", "Invalid",
+    "Previous", "Average", "P5", "Median", "P95",
+    "StdDev", "Stability", "Invalid",
     nullptr
 };
 
 template<>
 const char *SignalValue<>::getGetTypeStr(SignalValue<>::GetType type)
 {
+    if (type < 0 || type > GET_INVALID) type = GET_INVALID;
     return getTypeStrs[type];
 }
 
+bool parseWindowDuration(const char *str, TimeType &duration)
+{
+    char *end;
+    unsigned long long val = strtoull(str, &end, 10);
+
+    if (end == str || !val) return false;
+
+    switch (*end)
+    {
+        case 's': duration = val * oneSecond; break;
+        case 'm': duration = val * oneMinute; break;
+        case 'h': duration = val * oneHour; break;
+        case 'd': duration = val * oneDay; break;
+        default: return false;
+    }
+
+    return end[1] == '\0';
+}
+
 template<>
 SignalValue<>::GetType SignalValue<>::getGetTypeByStr(const char *type)
 {
@@ -43,13 +64,189 @@ SignalValue<>::GetType SignalValue<>::getGetTypeByStr(const char *type)
         if (!strcasecmp(type, getTypeStrs[i])) return (GetType)i;
     }
 
+    constexpr struct
+    {
+        const char *prefix;
+        GetType type;
+    } windowTypes[] =
+    {
+        {"Avg", GET_WINDOW_AVERAGE},
+        {"Min", GET_WINDOW_MIN},
+        {"Max", GET_WINDOW_MAX},
+        {"Std", GET_WINDOW_STDDEV},
+        {"Stability", GET_WINDOW_STABILITY}
+    };
+
+    for (auto &windowType : windowTypes)
+    {
+        TimeType duration;
+        const size_t prefixLength = strlen(windowType.prefix);
+
+        if (strncasecmp(type, windowType.prefix, prefixLength)) continue;
+        if (!parseWindowDuration(type + prefixLength, duration)) continue;
+
+        int window = signal_windows::get(duration);
+        if (window == -1) break;
+
+        return (GetType)(windowType.type | window);
+    }
+
     return GET_INVALID;
 }
 
+// Rolling Windows
+
+namespace signal_windows {
+
+TimeType durations[MAX_WINDOWS];
+size_t count = 0;
+
+int get(const TimeType duration)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (durations[i] == duration) return i;
+    }
+
+    if (count == MAX_WINDOWS)
+    {
+        errfunf_once("Too many different rolling windows (max: %zu)", MAX_WINDOWS);
+        return -1;
+    }
+
+    durations[count] = duration;
+    return count++;
+}
+
+} // namespace signal_windows
+
+// Rollups
+
+namespace rollup_tiers {
+
+Tier tiers[MAX_TIERS] =
+{
+    {oneMinute, 1440}, // 1 day
+    {oneHour, 720}     // 30 days
+};
+
+size_t count = 2;
+
+bool parse(const char *str)
+{
+    std::vector<std::string> tierStrs;
+    Tier newTiers[MAX_TIERS];
+    size_t newCount = 0;
+
+    if (strcasecmp(str, "none")) splitStr(tierStrs, str, ", ", false);
+
+    if (tierStrs.size() > MAX_TIERS)
+    {
+        errfunf("Too many rollup tiers (max: %zu)", MAX_TIERS);
+        return false;
+    }
+
+    for (auto &tierStr : tierStrs)
+    {
+        TimeType interval;
+        TimeType retention;
+        const size_t sep = tierStr.find(':');
+
+        if (sep == std::string::npos ||
+            !parseWindowDuration(tierStr.substr(0, sep).c_str(), interval) ||
+            !parseWindowDuration(tierStr.c_str() + sep + 1, retention) ||
+            retention < interval)
+        {
+            errfunf("Invalid rollup tier: %s", tierStr.c_str());
+            return false;
+        }
+
+        newTiers[newCount++] = {interval, size_t(retention / interval)};
+    }
+
+    std::copy(newTiers, newTiers + newCount, tiers);
+    count = newCount;
+
+    return true;
+}
+
+} // namespace rollup_tiers
+
 // Signal
 
 Signal sig;
 
+// Per-Cell Statistics
+
+namespace cells {
+
+Index index;
+size_t maxCells = 64;
+
+namespace {
+CellStats *active = nullptr;
+CellKey activeKey;
+} // anonymous namespace
+
+void prune()
+{
+    // Only runs on handovers, a linear scan is fine
+
+    while (index.size() > std::max(maxCells, size_t(1)))
+    {
+        auto oldest = index.end();
+
+        for (auto it = index.begin(); it != index.end(); ++it)
+        {
+            if (&it->second == active) continue;
+            if (oldest == index.end() || it->second.lastSeen < oldest->second.lastSeen) oldest = it;
+        }
+
+        if (oldest == index.end()) break;
+        index.erase(oldest);
+    }
+}
+
+CellStats &select(const CellKey &key)
+{
+    if (active && key == activeKey)
+    {
+        active->lastSeen = now;
+        return *active;
+    }
+
+    // Handover or first sample
+
+    CellStats &stats = index[key];
+
+    if (!stats.visits) stats.firstSeen = now;
+    stats.lastSeen = now;
+    stats.visits++;
+
+    active = &stats;
+    activeKey = key;
+
+    prune();
+
+    return stats;
+}
+
+const CellStats *getActive()
+{
+    return active;
+}
+
+const CellKey &getActiveKey()
+{
+    return activeKey;
+}
+
+} // namespace cells
+
+// Traffic
+
+Traffic traffic;
+
 // AT
 
 // CERSSI
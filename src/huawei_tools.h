@@ -20,12 +20,15 @@
 #define __HUAWEI_TOOLS_H__
 
 #include "tools.h"
+#include "stats.h"
 
 #include <string>
 #include <type_traits>
 #include <cstring>
 #include <cmath>
 #include <map>
+#include <memory>
+#include <unordered_map>
 
 // Signal
 
@@ -51,6 +54,36 @@ struct ValueStorage
     constexpr ValueStorage() : val(T()), lastUpdate(T()) {}
 };
 
+// "30s", "5m", "1h", "1d", ...
+
+bool parseWindowDuration(const char *str, TimeType &duration);
+
+// Rolling windows requested through the "Avg5m", "Min1m", ... columns.
+// Sample histories are only recorded once at least one window is in use.
+
+namespace signal_windows {
+constexpr size_t MAX_WINDOWS = SampleHistory<int>::MAX_WINDOWS;
+extern TimeType durations[MAX_WINDOWS];
+extern size_t count;
+int get(const TimeType duration);
+} // namespace signal_windows
+
+// Rollup tiers ("1m:1d, 1h:30d"), only recorded while the database is
+// open, which keeps retention / interval buckets of every signal value.
+// No tiers disables rollups.
+
+namespace rollup_tiers {
+constexpr size_t MAX_TIERS = 3;
+struct Tier
+{
+    TimeType interval;
+    size_t retention; // Buckets
+};
+extern Tier tiers[MAX_TIERS];
+extern size_t count;
+bool parse(const char *str);
+} // namespace rollup_tiers
+
 template<typename T = int, bool IS_SPEED_VALUE = false>
 struct SignalValue
 {
@@ -62,6 +95,11 @@ struct SignalValue
     float peakBW;
     double sum;
     size_t count;
+    std::unique_ptr<SampleHistory<T>> history;
+    std::unique_ptr<RollupTier[]> rollups; // One per rollup tier
+    P2Quantile quantiles[3]; // P5, Median, P95
+    RunningVariance variance; // Of the values, or of the speed for speed values
+    bool aggregatesOnly = false; // No history, rollups, quantiles or variance
 
     bool isSet() const { return count > 0; }
     float avg() const { return count ? sum / count : T(); }
@@ -77,6 +115,11 @@ struct SignalValue
         return (current.val - prevVal.val) / (float)timeDiff * oneSecond / 1024.f / 1024.f * 8.f;
     }
 
+    float getSpeedStdDevInMbits() const
+    {
+        return variance.stddev();
+    }
+
     float getDataTransferredInMB(const bool total = false) const
     {
         if (!count) return T();
@@ -132,17 +175,66 @@ struct SignalValue
         GET_FIRST,
         GET_PREVIOUS,
         GET_AVERAGE,
-        GET_INVALID
+        GET_P5,
+        GET_MEDIAN,
+        GET_P95,
+        GET_STDDEV,
+        GET_STABILITY,
+        GET_INVALID,
+
+        // Rolling windows, the window index is stored in the lower bits
+        GET_WINDOW_AVERAGE = 0x100,
+        GET_WINDOW_MIN = 0x200,
+        GET_WINDOW_MAX = 0x300,
+        GET_WINDOW_STDDEV = 0x400,
+        GET_WINDOW_STABILITY = 0x500,
+        GET_WINDOW_MASK = 0xFF
     };
 
     static const char *const getTypeStrs[];
     static const char *getGetTypeStr(const GetType type);
     static GetType getGetTypeByStr(const char *type);
 
+    template<typename TT>
+    static TT roundIfIntegral(const double val)
+    {
+        if (std::is_integral<TT>::value) return round(val);
+        return val;
+    }
+
+    template<typename TT = T>
+    TT getWindowVal(const int type) const
+    {
+        const size_t window = type & GET_WINDOW_MASK;
+        typename SampleHistory<T>::Aggregate aggregate;
+
+        if (!history || window >= signal_windows::count) return TT();
+        if (!history->query(window, signal_windows::durations[window], now, aggregate))
+            return TT();
+
+        switch (type & ~GET_WINDOW_MASK)
+        {
+            case GET_WINDOW_AVERAGE:
+            {
+                if (std::is_integral<TT>::value) return round(aggregate.avg());
+                else return aggregate.avg();
+            }
+            case GET_WINDOW_MIN: return aggregate.min;
+            case GET_WINDOW_MAX: return aggregate.max;
+            case GET_WINDOW_STDDEV: return roundIfIntegral<TT>(aggregate.stddev());
+            case GET_WINDOW_STABILITY:
+                return roundIfIntegral<TT>(coefficientOfVariation(aggregate.stddev(), aggregate.avg()));
+            default:;
+        }
+
+        return TT();
+    }
+
     template<typename TT = T>
     TT getVal(const int type = GET_CURRENT) const
     {
         if (!isSet()) return TT();
+        if (type >= GET_WINDOW_AVERAGE) return getWindowVal<TT>(type);
 
         switch (type)
         {
@@ -158,6 +250,16 @@ struct SignalValue
                 if (std::is_integral<TT>::value) return round(avg());
                 else return avg();
             }
+            case GET_P5:
+            case GET_MEDIAN:
+            case GET_P95:
+            {
+                const double q = quantiles[type - GET_P5].get();
+                if (std::is_integral<TT>::value) return round(q);
+                else return q;
+            }
+            case GET_STDDEV:    return roundIfIntegral<TT>(variance.stddev());
+            case GET_STABILITY: return roundIfIntegral<TT>(variance.cv());
             default:;
         }
 
@@ -180,7 +282,32 @@ struct SignalValue
         {
             val = val_;
         }
+        if (signal_windows::count && !IS_SPEED_VALUE && !aggregatesOnly)
+        {
+            // Unchanged values are recorded too, the
+            // windows are supposed to cover time.
+            if (!history) history.reset(new SampleHistory<T>);
+            history->push(now, val, signal_windows::durations, signal_windows::count);
+        }
+        if (rollup_tiers::count && !IS_SPEED_VALUE && !aggregatesOnly)
+        {
+            if (!rollups) rollups.reset(new RollupTier[rollup_tiers::MAX_TIERS]);
+            const TimeType time = getUnixMilliSeconds();
+
+            for (size_t i = 0; i < rollup_tiers::count; i++)
+            {
+                const rollup_tiers::Tier &tier = rollup_tiers::tiers[i];
+                rollups[i].push(time, val, tier.interval);
+            }
+        }
         if (isSet() && current.val == val) return;
+        // The statistics below all see the same samples: value changes,
+        // repeated polls of an unchanged value aren't counted again
+        if (!IS_SPEED_VALUE && !aggregatesOnly)
+        {
+            for (auto &quantile : quantiles) quantile.update(val);
+            variance.update(val);
+        }
         prev = current;
         current = val;
         if (!count) first = val;
@@ -192,6 +319,7 @@ struct SignalValue
         {
             float currentBW = getAvgSpeedInMbits();
             if (currentBW > peakBW) peakBW = currentBW;
+            if (count >= 2) variance.update(currentBW);
         }
     }
 
@@ -209,11 +337,72 @@ struct SignalValue
         update(val.c_str());
     }
 
+    // Accumulated statistics for checkpoints, rolling
+    // windows and rollups are not part of it
+
+    struct State
+    {
+        T current;
+        T min;
+        T max;
+        T first;
+        T prev;
+        float peakBW;
+        double sum;
+        uint64_t count;
+        P2Quantile quantiles[3];
+        RunningVariance variance;
+    };
+
+    void getState(State &state) const
+    {
+        state.current = current.val;
+        state.min = min.val;
+        state.max = max.val;
+        state.first = first.val;
+        state.prev = prev.val;
+        state.peakBW = peakBW;
+        state.sum = sum;
+        state.count = count;
+        std::copy(quantiles, quantiles + 3, state.quantiles);
+        state.variance = variance;
+    }
+
+    void setState(const State &state)
+    {
+        // Update times are monotonic and don't survive a restart.
+        // Speed values get the oldest possible time, so the first
+        // speed after a restore isn't the traffic of the downtime.
+        const TimeType time = IS_SPEED_VALUE ? 0 : now;
+
+        current.val = state.current;
+        min.val = state.min;
+        max.val = state.max;
+        first.val = state.first;
+        prev.val = state.prev;
+        current.lastUpdate = min.lastUpdate = max.lastUpdate = time;
+        first.lastUpdate = prev.lastUpdate = time;
+        peakBW = state.peakBW;
+        sum = state.sum;
+        count = state.count;
+        std::copy(state.quantiles, state.quantiles + 3, quantiles);
+        variance = state.variance;
+    }
+
     void reset()
     {
-        memset((void*)this, 0, sizeof(*this));
+        current = first = prev = ValueStorage<T>();
         min = maxVal(T());
         max = minVal(T());
+        peakBW = 0.f;
+        sum = 0.0;
+        count = 0;
+        if (history) history->reset();
+        rollups.reset();
+        quantiles[0].reset(0.05);
+        quantiles[1].reset(0.5);
+        quantiles[2].reset(0.95);
+        variance.reset();
     }
 
     SignalValue() { reset(); }
@@ -283,7 +472,9 @@ struct ConnStatus
     }
 };
 
-struct Signal
+// Values of /api/device/signal, kept overall and per serving cell
+
+struct RadioValues
 {
     #warning WEB
     SignalValue<> RSCP;
@@ -302,6 +493,19 @@ struct Signal
     SignalValue<> TXPWrPSRS;
     SignalValue<> TXPWrPPRACH;
 
+    explicit RadioValues(const bool aggregatesOnly = false)
+    {
+        for (SignalValue<> *value : {&RSCP, &ECIO, &RSRP, &RSRQ, &RSSI, &SINR, &CQI[0], &CQI[1],
+                                     &DLMCS[0], &DLMCS[1], &UPMCS, &TXPWrPPUSCH, &TXPWrPPUCCH,
+                                     &TXPWrPSRS, &TXPWrPPRACH})
+        {
+            value->aggregatesOnly = aggregatesOnly;
+        }
+    }
+};
+
+struct Signal : RadioValues
+{
     XMLNumType band;
     XMLNumType cell;
     XMLNumType DLBW;
@@ -313,6 +517,8 @@ struct Signal
     std::string operatorNameShort;
     XMLNumType PLMN;
 
+    ConnStatus connStatus;
+
     struct AT
     {
         // CERSSI
@@ -321,8 +527,11 @@ struct Signal
         {
             static constexpr int MAX_ANTENNAS = 4;
             bool isSet() const;
+            TimeType lastUpdate; // Of the last URC
 
             int numAntennas;
+            SignalValue<> servingRSRP; // Of all antennas combined
+            SignalValue<> servingSINR; // Of all antennas combined
             SignalValue<> RSRQ;
             SignalValue<> RSRP[MAX_ANTENNAS];
             SignalValue<> SINR[MAX_ANTENNAS];
@@ -333,6 +542,7 @@ struct Signal
         struct CERSSI_WCDMA
         {
             bool isSet() const;
+            TimeType lastUpdate; // Of the last URC
 
             SignalValue<> RSCP;
             SignalValue<> ECIO;
@@ -341,6 +551,7 @@ struct Signal
         struct CERSSI_GSM
         {
             bool isSet() const;
+            TimeType lastUpdate; // Of the last URC
 
             SignalValue<> RSSI;
         } cerssiGSM;
@@ -350,6 +561,7 @@ struct Signal
         struct HCSQ_LTE
         {
             bool isSet() const;
+            TimeType lastUpdate; // Of the last URC
 
             SignalValue<> RSRP;
             SignalValue<> RSRQ;
@@ -360,6 +572,7 @@ struct Signal
         struct HCSQ_WCDMA
         {
             bool isSet() const;
+            TimeType lastUpdate; // Of the last URC
 
             SignalValue<> RSSI;
             SignalValue<> RSCP;
@@ -369,6 +582,7 @@ struct Signal
         struct HCSQ_GSM
         {
             bool isSet() const;
+            TimeType lastUpdate; // Of the last URC
 
             SignalValue<> RSSI;
         } hcsqGSM;
@@ -394,6 +608,185 @@ namespace x {
 static auto &signal = sig;
 }
 
+// Per-Cell Statistics
+
+/*
+ * Separate aggregates for every serving cell, so that handovers don't
+ * mix the min/max/avg of different cells. The active cell is cached,
+ * switching cells costs a single hash lookup.
+ */
+
+struct CellKey
+{
+    XMLNumType PLMN;
+    XMLNumType mode;
+    XMLNumType band;
+    XMLNumType cell;
+
+    bool operator==(const CellKey &other) const
+    {
+        return PLMN == other.PLMN && mode == other.mode &&
+               band == other.band && cell == other.cell;
+    }
+
+    bool operator!=(const CellKey &other) const { return !(*this == other); }
+
+    // All fields were reported
+    bool isValid() const
+    {
+        return PLMN != __XML_NUM_ERROR__ && mode != __XML_NUM_ERROR__ &&
+               band != __XML_NUM_ERROR__ && cell != __XML_NUM_ERROR__;
+    }
+};
+
+struct CellKeyHash
+{
+    size_t operator()(const CellKey &key) const
+    {
+        size_t hash = std::hash<XMLNumType>()(key.cell);
+        for (const XMLNumType val : {key.PLMN, key.mode, key.band})
+            hash ^= std::hash<XMLNumType>()(val) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+};
+
+// Only current, min, max and average are shown per cell. A history
+// and rollups for every value of up to maxCells cells would cost
+// megabytes, so these are kept for the overall values only.
+
+struct CellStats : RadioValues
+{
+    CellStats() : RadioValues(true) {}
+
+    TimeType firstSeen = 0;
+    TimeType lastSeen = 0;
+    size_t visits = 0; // Times this cell became the serving cell
+};
+
+namespace cells {
+typedef std::unordered_map<CellKey, CellStats, CellKeyHash> Index;
+extern Index index;
+extern size_t maxCells; // The least recently seen cells beyond are dropped
+CellStats &select(const CellKey &key);
+void prune();
+const CellStats *getActive();
+const CellKey &getActiveKey();
+} // namespace cells
+
+// Traffic
+
+struct Traffic
+{
+    TrafficStats current{"Current"};
+    TrafficStats monthly{"Monthly"};
+    TrafficStats total{"Total"};
+};
+
+extern Traffic traffic;
+
+// Metrics
+
+// Flat view of a SignalValue for the loggers and exporters.
+// count only increases when the value has changed.
+
+struct Metric
+{
+    const char *name;
+    double val;
+    TimeType lastUpdate;
+    size_t count;
+    RollupTier *rollups; // rollup_tiers::count entries, may be null
+
+    // Type erased access to the SignalValue for aggregated values
+    const void *value;
+    bool (*get)(const void *value, int type, double &val);
+};
+
+template<typename T, bool IS_SPEED_VALUE>
+bool getMetricVal(const void *value, const int type, double &val)
+{
+    auto &signalValue = *static_cast<const SignalValue<T, IS_SPEED_VALUE> *>(value);
+    if (!signalValue.isSet()) return false;
+    val = signalValue.template getVal<double>(type);
+    return true;
+}
+
+template<typename T, bool IS_SPEED_VALUE>
+Metric getMetric(const char *name, const SignalValue<T, IS_SPEED_VALUE> &value)
+{
+    return {name, (double)*value.current, value.current.lastUpdate, value.count,
+            value.rollups.get(), &value, getMetricVal<T, IS_SPEED_VALUE>};
+}
+
+template<typename F>
+void forEachMetric(F &&f)
+{
+    const Signal &s = sig;
+
+    f(getMetric("rscp", s.RSCP));
+    f(getMetric("ecio", s.ECIO));
+    f(getMetric("rsrp", s.RSRP));
+    f(getMetric("rsrq", s.RSRQ));
+    f(getMetric("rssi", s.RSSI));
+    f(getMetric("sinr", s.SINR));
+    f(getMetric("cqi0", s.CQI[0]));
+    f(getMetric("cqi1", s.CQI[1]));
+    f(getMetric("dl_mcs0", s.DLMCS[0]));
+    f(getMetric("dl_mcs1", s.DLMCS[1]));
+    f(getMetric("ul_mcs", s.UPMCS));
+    f(getMetric("tx_power_ppusch", s.TXPWrPPUSCH));
+    f(getMetric("tx_power_ppucch", s.TXPWrPPUCCH));
+    f(getMetric("tx_power_psrs", s.TXPWrPSRS));
+    f(getMetric("tx_power_pprach", s.TXPWrPPRACH));
+
+    const Signal::AT &at = s.at;
+
+    static const char *const cerssiRSRP[] =
+    {
+        "at_cerssi_lte_rsrp0", "at_cerssi_lte_rsrp1",
+        "at_cerssi_lte_rsrp2", "at_cerssi_lte_rsrp3"
+    };
+
+    static const char *const cerssiSINR[] =
+    {
+        "at_cerssi_lte_sinr0", "at_cerssi_lte_sinr1",
+        "at_cerssi_lte_sinr2", "at_cerssi_lte_sinr3"
+    };
+
+    f(getMetric("at_cerssi_lte_rsrp", at.cerssiLTE.servingRSRP));
+    f(getMetric("at_cerssi_lte_sinr", at.cerssiLTE.servingSINR));
+    f(getMetric("at_cerssi_lte_rsrq", at.cerssiLTE.RSRQ));
+    for (int i = 0; i < Signal::AT::CERSSI_LTE::MAX_ANTENNAS; i++)
+        f(getMetric(cerssiRSRP[i], at.cerssiLTE.RSRP[i]));
+    for (int i = 0; i < Signal::AT::CERSSI_LTE::MAX_ANTENNAS; i++)
+        f(getMetric(cerssiSINR[i], at.cerssiLTE.SINR[i]));
+    f(getMetric("at_cerssi_lte_ri", at.cerssiLTE.RI));
+    f(getMetric("at_cerssi_lte_cqi0", at.cerssiLTE.CQI[0]));
+    f(getMetric("at_cerssi_lte_cqi1", at.cerssiLTE.CQI[1]));
+    f(getMetric("at_cerssi_wcdma_rscp", at.cerssiWCDMA.RSCP));
+    f(getMetric("at_cerssi_wcdma_ecio", at.cerssiWCDMA.ECIO));
+    f(getMetric("at_cerssi_gsm_rssi", at.cerssiGSM.RSSI));
+    f(getMetric("at_hcsq_lte_rsrp", at.hcsqLTE.RSRP));
+    f(getMetric("at_hcsq_lte_rsrq", at.hcsqLTE.RSRQ));
+    f(getMetric("at_hcsq_lte_rssi", at.hcsqLTE.RSSI));
+    f(getMetric("at_hcsq_lte_sinr", at.hcsqLTE.SINR));
+    f(getMetric("at_hcsq_wcdma_rssi", at.hcsqWCDMA.RSSI));
+    f(getMetric("at_hcsq_wcdma_rscp", at.hcsqWCDMA.RSCP));
+    f(getMetric("at_hcsq_wcdma_ecio", at.hcsqWCDMA.ECIO));
+    f(getMetric("at_hcsq_gsm_rssi", at.hcsqGSM.RSSI));
+    f(getMetric("at_rssi_level", at.rssi.RSSILevel));
+
+    f(getMetric("traffic_current_duration", traffic.current.CD));
+    f(getMetric("traffic_current_download", traffic.current.DL));
+    f(getMetric("traffic_current_upload", traffic.current.UP));
+    f(getMetric("traffic_monthly_duration", traffic.monthly.CD));
+    f(getMetric("traffic_monthly_download", traffic.monthly.DL));
+    f(getMetric("traffic_monthly_upload", traffic.monthly.UP));
+    f(getMetric("traffic_total_duration", traffic.total.CD));
+    f(getMetric("traffic_total_download", traffic.total.DL));
+    f(getMetric("traffic_total_upload", traffic.total.UP));
+}
+
 // Network
 
 cxx14_constexpr float getSignalStrengthInPercent(const int RSSILevel)
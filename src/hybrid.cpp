@@ -0,0 +1,227 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifdef WORK_IN_PROGRESS
+
+#include "hybrid.h"
+
+#include <algorithm>
+
+namespace hybrid {
+
+bool enabled = false;
+int webInterval = 5000;
+int maxAge = 3000;
+
+namespace {
+
+// Minimum delay between web polls without AT values, same as
+// the request limit of the web only view
+constexpr TimeType WEB_MIN_INTERVAL = 100;
+
+using x::signal;
+
+struct Field
+{
+    const char *name;
+    SignalValue<> *value;
+    Provenance provenance;
+};
+
+Field fields[] =
+{
+    { "RSCP",   &signal.RSCP,        {} },
+    { "ECIO",   &signal.ECIO,        {} },
+    { "RSRP",   &signal.RSRP,        {} },
+    { "RSRQ",   &signal.RSRQ,        {} },
+    { "RSSI",   &signal.RSSI,        {} },
+    { "SINR",   &signal.SINR,        {} },
+    { "CQI0",   &signal.CQI[0],      {} },
+    { "CQI1",   &signal.CQI[1],      {} },
+    { "DLMCS0", &signal.DLMCS[0],    {} },
+    { "DLMCS1", &signal.DLMCS[1],    {} },
+    { "UPMCS",  &signal.UPMCS,       {} },
+    { "TXPPUSCH", &signal.TXPWrPPUSCH, {} },
+    { "TXPPUCCH", &signal.TXPWrPPUCCH, {} },
+    { "TXPSRS",   &signal.TXPWrPSRS,   {} },
+    { "TXPPRACH", &signal.TXPWrPPRACH, {} }
+};
+
+// Preferred AT value first, ^CERSSI has more detail than ^HCSQ.
+// Its RSRP and SINR of all antennas combined match the web values.
+
+struct Mapping
+{
+    SignalValue<> *target;
+    const SignalValue<> *value;
+    const TimeType *lastUpdate;
+};
+
+const Mapping mappings[] =
+{
+    // LTE
+    { &signal.RSRP,   &signal.at.cerssiLTE.servingRSRP,  &signal.at.cerssiLTE.lastUpdate   },
+    { &signal.RSRP,   &signal.at.hcsqLTE.RSRP,           &signal.at.hcsqLTE.lastUpdate     },
+    { &signal.RSRQ,   &signal.at.cerssiLTE.RSRQ,         &signal.at.cerssiLTE.lastUpdate   },
+    { &signal.RSRQ,   &signal.at.hcsqLTE.RSRQ,           &signal.at.hcsqLTE.lastUpdate     },
+    { &signal.SINR,   &signal.at.cerssiLTE.servingSINR,  &signal.at.cerssiLTE.lastUpdate   },
+    { &signal.SINR,   &signal.at.hcsqLTE.SINR,           &signal.at.hcsqLTE.lastUpdate     },
+    { &signal.RSSI,   &signal.at.hcsqLTE.RSSI,           &signal.at.hcsqLTE.lastUpdate     },
+    { &signal.CQI[0], &signal.at.cerssiLTE.CQI[0],       &signal.at.cerssiLTE.lastUpdate   },
+    { &signal.CQI[1], &signal.at.cerssiLTE.CQI[1],       &signal.at.cerssiLTE.lastUpdate   },
+
+    // WCDMA
+    { &signal.RSCP,   &signal.at.cerssiWCDMA.RSCP,       &signal.at.cerssiWCDMA.lastUpdate },
+    { &signal.RSCP,   &signal.at.hcsqWCDMA.RSCP,         &signal.at.hcsqWCDMA.lastUpdate   },
+    { &signal.ECIO,   &signal.at.cerssiWCDMA.ECIO,       &signal.at.cerssiWCDMA.lastUpdate },
+    { &signal.ECIO,   &signal.at.hcsqWCDMA.ECIO,         &signal.at.hcsqWCDMA.lastUpdate   },
+    { &signal.RSSI,   &signal.at.hcsqWCDMA.RSSI,         &signal.at.hcsqWCDMA.lastUpdate   },
+
+    // GSM
+    { &signal.RSSI,   &signal.at.cerssiGSM.RSSI,         &signal.at.cerssiGSM.lastUpdate   },
+    { &signal.RSSI,   &signal.at.hcsqGSM.RSSI,           &signal.at.hcsqGSM.lastUpdate     }
+};
+
+TimeType lastWebUpdate;
+
+Field *findField(const SignalValue<> &value)
+{
+    for (Field &field : fields)
+        if (field.value == &value) return &field;
+
+    return nullptr;
+}
+
+bool isFresh(const TimeType time)
+{
+    return time && timeElapsedLT(time, (TimeType)maxAge);
+}
+
+bool isATFresh()
+{
+    for (const Field &field : fields)
+        if (field.provenance.source == SOURCE_AT && isFresh(field.provenance.time)) return true;
+
+    return false;
+}
+
+} // anonymous namespace
+
+const char *getSourceStr(Source source)
+{
+    switch (source)
+    {
+        case SOURCE_NONE: return "-";
+        case SOURCE_WEB: return "WEB";
+        case SOURCE_AT: return "AT";
+    }
+
+    return "-";
+}
+
+Provenance getProvenance(const SignalValue<> &value)
+{
+    const Field *field = findField(value);
+    return field ? field->provenance : Provenance();
+}
+
+bool isOwnedByAT(const SignalValue<> &value)
+{
+    if (!enabled) return false;
+
+    const Field *field = findField(value);
+    return field && field->provenance.source == SOURCE_AT && isFresh(field->provenance.time);
+}
+
+bool isWebDue()
+{
+    if (!lastWebUpdate) return true;
+    return timeElapsedGE(lastWebUpdate, isATFresh() ? (TimeType)webInterval : WEB_MIN_INTERVAL);
+}
+
+void webUpdated()
+{
+    updateTime();
+    lastWebUpdate = now;
+
+    for (Field &field : fields)
+    {
+        if (!field.value->isSet() || isOwnedByAT(*field.value)) continue;
+        field.provenance = {SOURCE_WEB, now};
+    }
+}
+
+bool mergeAT()
+{
+    bool merged = false;
+
+    // Targets with a fresh preferred value, the fallbacks are skipped
+    const SignalValue<> *handled[sizeof(mappings) / sizeof(*mappings)];
+    size_t numHandled = 0;
+
+    for (const Mapping &mapping : mappings)
+    {
+        const TimeType time = *mapping.lastUpdate;
+        if (!isFresh(time) || !mapping.value->isSet()) continue;
+
+        if (std::find(handled, handled + numHandled, mapping.target) != handled + numHandled)
+            continue;
+
+        handled[numHandled++] = mapping.target;
+
+        Field *field = findField(*mapping.target);
+
+        // Nothing new since the last merge
+        if (field->provenance.source == SOURCE_AT && field->provenance.time >= time) continue;
+
+        mapping.target->update(mapping.value->getVal());
+        field->provenance = {SOURCE_AT, time};
+        merged = true;
+    }
+
+    return merged;
+}
+
+void formatSources(StrBuf &str)
+{
+    for (const Source source : {SOURCE_AT, SOURCE_WEB})
+    {
+        TimeType newest = 0;
+        bool first = true;
+
+        for (const Field &field : fields)
+        {
+            if (field.provenance.source != source) continue;
+
+            str.format("%s%s", first ? getSourceStr(source) : ",", first ? ": " : "");
+            str += field.name;
+            if (field.provenance.time > newest) newest = field.provenance.time;
+            first = false;
+        }
+
+        if (!first)
+        {
+            StrBuf age;
+            str.format(" (%s ago)\n", fmtMillis(getElapsedTime(newest), age).c_str());
+        }
+    }
+}
+
+} // namespace hybrid
+
+#endif
@@ -0,0 +1,73 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __HYBRID_H__
+#define __HYBRID_H__
+
+#ifdef WORK_IN_PROGRESS
+
+#include "huawei_tools.h"
+
+/*
+ * Merged signal source for --show-signal-strength: while AT URCs are
+ * flowing they supply RSRP/RSRQ/SINR/... of the radio values, the web
+ * API is polled less often and only fills in what AT doesn't report
+ * (band, bandwidth, MCS, TX power, cell, ...).
+ */
+
+namespace hybrid {
+
+extern bool enabled;
+extern int webInterval; // Milliseconds between web polls while AT is fresh
+extern int maxAge;      // Milliseconds until an AT value counts as stale
+
+enum Source
+{
+    SOURCE_NONE,
+    SOURCE_WEB,
+    SOURCE_AT
+};
+
+struct Provenance
+{
+    Source source;
+    TimeType time; // Last received
+};
+
+const char *getSourceStr(Source source);
+
+// Of a radio value of x::signal
+Provenance getProvenance(const SignalValue<> &value);
+
+// Web polls must leave it alone
+bool isOwnedByAT(const SignalValue<> &value);
+
+bool isWebDue();
+void webUpdated();
+
+// Takes over new AT values, true if there were any
+bool mergeAT();
+
+// One line per source for the status screen
+void formatSources(StrBuf &str);
+
+} // namespace hybrid
+
+#endif
+
+#endif // __HYBRID_H__
@@ -0,0 +1,117 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __LINE_BUFFER_H__
+#define __LINE_BUFFER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Persistent receive buffer that frames a byte stream into lines.
+ *
+ * Data is received directly into getWritePtr(), a partial line at the
+ * end of a read is kept and completed by the next one. Complete lines
+ * are handed out in place (NUL-terminated, trailing '\r' stripped), only
+ * the unfinished tail is moved to the front after each pass so every
+ * line stays contiguous. A line that doesn't fit into the buffer is
+ * discarded up to its newline and counted.
+ */
+
+struct LineCounters
+{
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t discardedLines;
+};
+
+template<size_t N>
+class LineBuffer
+{
+public:
+    char *getWritePtr() { return buf + end; }
+    size_t getWritable() const { return N - end; }
+
+    // Call after receiving length bytes into getWritePtr()
+
+    template<typename F>
+    void commit(size_t length, F &&onLine)
+    {
+        counters.bytes += length;
+        end += length;
+
+        size_t start = 0;
+
+        while (char *nl = (char *)memchr(buf + scanPos, '\n', end - scanPos))
+        {
+            const size_t lineEnd = nl - buf;
+            scanPos = lineEnd + 1;
+
+            if (discarding)
+            {
+                // Tail of an overlong line
+                discarding = false;
+                start = scanPos;
+                continue;
+            }
+
+            size_t lineLength = lineEnd - start;
+            if (lineLength && buf[start + lineLength - 1] == '\r') lineLength--;
+            buf[start + lineLength] = '\0'; // Overwrites '\r' or '\n'
+
+            counters.lines++;
+            onLine((const char *)buf + start, lineLength);
+
+            start = scanPos;
+        }
+
+        const size_t remaining = end - start;
+
+        if (remaining == N)
+        {
+            // No newline within the whole buffer
+            if (!discarding) counters.discardedLines++;
+            discarding = true;
+            end = scanPos = 0;
+            return;
+        }
+
+        if (start && remaining) memmove(buf, buf + start, remaining);
+
+        end = remaining;
+        scanPos = remaining;
+    }
+
+    void reset()
+    {
+        end = scanPos = 0;
+        discarding = false;
+    }
+
+    const LineCounters &getCounters() const { return counters; }
+
+private:
+    size_t end = 0;
+    size_t scanPos = 0;
+    bool discarding = false;
+    LineCounters counters = {};
+    char buf[N];
+};
+
+#endif // __LINE_BUFFER_H__
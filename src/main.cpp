@@ -21,6 +21,18 @@
 #include "cli_tools.h"
 #include "at_tcp.h"
 #include "web.h"
+#include "tslog.h"
+#include "pipeline.h"
+#include "db.h"
+#include "exporter.h"
+#include "stream.h"
+#include "alerts.h"
+#include "query.h"
+#include "shm.h"
+#include "checkpoint.h"
+#include "proxy.h"
+#include "hybrid.h"
+#include "align.h"
 
 #include <cstdlib>
 #include <cstdio>
@@ -36,8 +48,16 @@ void NORETURN exit_success(bool printSuccess, bool breakBeforePrintingSuccess)
         if (breakBeforePrintingSuccess) outf("\n");
         outf("SUCCESS\n");
     }
+    pipeline::stop();
+    tslog::close();
+    db::close();
+    exporter::stop();
+    shm::close();
+    checkpoint::close();
+    stream::flush();
     web::logout();
     web::deinit();
+    proxy::stop();
     at_tcp::disconnect();
     at_tcp::deinit();
     windows::exitWait = true;
@@ -52,8 +72,16 @@ void NORETURN exit_error(bool printError)
         if (printError) outf(stderr, "\nERROR\n");
         info.linef("Check debug.log to see what's going on");
     }
+    pipeline::stop();
+    tslog::close();
+    db::close();
+    exporter::stop();
+    shm::close();
+    checkpoint::close();
+    stream::flush();
     web::logout();
     web::deinit();
+    proxy::stop();
     at_tcp::disconnect();
     at_tcp::deinit();
     windows::exitWait = true;
@@ -86,6 +114,7 @@ int main(int argc, char **argv)
     bool showSignalStrength = false;
     bool showWlanClients = false;
     bool showTraffic = false;
+    bool exportMetrics = false;
     const char *relayRequest = nullptr;
     const char *relayPostData = nullptr;
     bool relayLoop = false;
@@ -94,6 +123,12 @@ int main(int argc, char **argv)
     bool disconnect = false;
     bool reboot = false;
     bool showAtTcpSignalStrength = false;
+    const char *atTcpCommand = nullptr;
+    bool runProxy = false;
+    bool antennaAlignment = false;
+    const char *recordFile = nullptr;
+    const char *dbFile = nullptr;
+    const char *queryFiles = nullptr;
 
     cfg = config4cpp::Configuration::create();
 
@@ -107,11 +142,45 @@ int main(int argc, char **argv)
         copystr(web::routerUser, cfg->lookupString("", "web_router_user"));
         copystr(web::routerPass, cfg->lookupString("", "web_router_pass"));
         web::cli::trafficColumnSpacing = cfg->lookupInt("", "web_cli_traffic_column_spacing");
+        const char *signalStrengthColumns =
+            cfg->lookupString("", "web_cli_signal_strength_columns", "");
+        if (signalStrengthColumns[0])
+            copystr(web::cli::signalStrengthColumns, signalStrengthColumns);
+        web::cli::signalStrengthColumnSpacing =
+            cfg->lookupInt("", "web_cli_signal_strength_column_spacing",
+                           web::cli::signalStrengthColumnSpacing);
+        web::cli::signalStrengthCellTable =
+            cfg->lookupBoolean("", "web_cli_signal_strength_cell_table",
+                               web::cli::signalStrengthCellTable);
+        cells::maxCells = cfg->lookupInt("", "cell_stats_max_cells", (int)cells::maxCells);
 
         // AT TCP
 
         copystr(at_tcp::routerIP, cfg->lookupString("", "at_tcp_router_ip"));
         at_tcp::routerPort = cfg->lookupInt("", "at_tcp_router_port");
+        copystr(at_tcp::serialDevice, cfg->lookupString("", "at_serial_device", at_tcp::serialDevice));
+        at_tcp::serialBaudRate = cfg->lookupInt("", "at_serial_baud_rate", at_tcp::serialBaudRate);
+        at_tcp::silenceTimeout = cfg->lookupInt("", "at_tcp_silence_timeout",
+                                                 at_tcp::silenceTimeout);
+        at_tcp::commandPipelineDepth = cfg->lookupInt("", "at_tcp_command_pipeline_depth",
+                                                      at_tcp::commandPipelineDepth);
+
+        config4cpp::StringVector initCommands;
+        cfg->lookupList("", "at_tcp_init_commands", initCommands, config4cpp::StringVector());
+
+        for (int i = 0; i < initCommands.length(); i++)
+            at_tcp::initCommands.push_back(initCommands[i]);
+
+        hybrid::enabled = cfg->lookupBoolean("", "hybrid_signal_source", hybrid::enabled);
+        hybrid::webInterval = cfg->lookupInt("", "hybrid_web_interval", hybrid::webInterval);
+        hybrid::maxAge = cfg->lookupInt("", "hybrid_max_age", hybrid::maxAge);
+
+        align::peakHold = cfg->lookupInt("", "antenna_alignment_peak_hold", align::peakHold);
+        align::frameRate = cfg->lookupInt("", "antenna_alignment_frame_rate", align::frameRate);
+
+        proxy::port = cfg->lookupInt("", "at_tcp_proxy_port", proxy::port);
+        copystr(proxy::bindAddress, cfg->lookupString("", "at_tcp_proxy_bind", proxy::bindAddress));
+        copystr(proxy::ptyLink, cfg->lookupString("", "at_tcp_proxy_pty", proxy::ptyLink));
 
         if (!at_tcp::routerIP[0]) copystr(at_tcp::routerIP, web::routerIP);
 
@@ -139,6 +208,61 @@ int main(int argc, char **argv)
 
         if (cfg->lookupBoolean("", "cli_auto_resize_console_once"))
             cli::windows::autoResizeConsoleOnce = true;
+
+        // Recording
+
+        copystr(tslog::path, cfg->lookupString("", "record_file", ""));
+        tslog::flushInterval = cfg->lookupInt("", "record_flush_interval", tslog::flushInterval);
+
+        copystr(db::path, cfg->lookupString("", "db_file", ""));
+        db::batchSize = cfg->lookupInt("", "db_batch_size", db::batchSize);
+        db::batchInterval = cfg->lookupInt("", "db_batch_interval", db::batchInterval);
+        db::rawRetention = cfg->lookupInt("", "db_raw_retention", db::rawRetention);
+
+        copystr(checkpoint::path, cfg->lookupString("", "checkpoint_file", ""));
+        checkpoint::interval = cfg->lookupInt("", "checkpoint_interval", checkpoint::interval);
+
+        // Rollups
+
+        if (!rollup_tiers::parse(cfg->lookupString("", "rollup_tiers", "1m:1d, 1h:30d")))
+        {
+            cfg->destroy();
+            windows::wait();
+            return 1;
+        }
+
+        // Exporter
+
+        exporter::port = cfg->lookupInt("", "exporter_port", exporter::port);
+
+        // Shared Memory
+
+        copystr(shm::name, cfg->lookupString("", "shm_name", ""));
+
+        // Streaming Output
+
+        if (!stream::setFormat(cfg->lookupString("", "stream_format", "none")))
+        {
+            cfg->destroy();
+            windows::wait();
+            return 1;
+        }
+
+        stream::changedOnly = cfg->lookupBoolean("", "stream_changed_only", stream::changedOnly);
+        stream::flushInterval = cfg->lookupInt("", "stream_flush_interval", stream::flushInterval);
+
+        // Alerts
+
+        config4cpp::StringVector alertRules;
+        cfg->lookupList("", "alert_rules", alertRules, config4cpp::StringVector());
+
+        for (int i = 0; i < alertRules.length(); i++)
+        {
+            if (alerts::compile(alertRules[i])) continue;
+            cfg->destroy();
+            windows::wait();
+            return 1;
+        }
     }
     catch (const config4cpp::ConfigurationException &ex)
     {
@@ -171,13 +295,38 @@ int main(int argc, char **argv)
              " --set-antenna-type <type>\n"
              " --show-antenna-type\n"
              " --show-signal-strength\n"
+             " --signal-strength-columns <columns>\n"
              " --show-wlan-clients\n"
              " --show-traffic\n"
 #ifdef WORK_IN_PROGRESS
              " --show-at-tcp-signal-strength\n"
              " --at-tcp-signal-strength-columns <columns>\n"
+             " --at-tcp-command <command>\n"
+             " --at-serial <device>\n"
+             " --at-tcp-proxy <port>\n"
+             " --at-tcp-proxy-bind <address>\n"
+             " --at-tcp-proxy-pty <path>\n"
+             " --hybrid-signal-source\n"
+             " --antenna-alignment\n"
 #endif
              " --no-clear-screen\n"
+             " --format <ndjson|csv>\n"
+             " --changed-only\n"
+             " --flush-interval <milliseconds>\n"
+             " --record <file>\n"
+             " --dump-record <file>\n"
+             " --query <file>[,<file>...]\n"
+             " --query-metrics <metric>[,<metric>...]\n"
+             " --query-from <time>\n"
+             " --query-to <time>\n"
+             " --query-band <band>\n"
+             " --query-cell <cell>\n"
+             " --query-threshold <value>\n"
+             " --query-per-file\n"
+             " --db <file>\n"
+             " --exporter <port>\n"
+             " --shm <name>\n"
+             " --checkpoint <file>\n"
              " --relay <url>\n"
              " --relay-post-data <data>\n"
              " --relay-loop\n"
@@ -231,9 +380,31 @@ int main(int argc, char **argv)
         else if (!strcmp(arg, "--set-antenna-type")) antennaType = getArgument();
         else if (!strcmp(arg, "--show-antenna-type")) showAntennaType = true;
         else if (!strcmp(arg, "--show-signal-strength")) showSignalStrength = true;
+        else if (!strcmp(arg, "--signal-strength-columns")) copystr(web::cli::signalStrengthColumns, getArgument());
         else if (!strcmp(arg, "--show-wlan-clients")) showWlanClients = true;
         else if (!strcmp(arg, "--show-traffic")) showTraffic = true;
         else if (!strcmp(arg, "--no-clear-screen")) cli::status::noClearScreen = true;
+        else if (!strcmp(arg, "--format")) { if (!stream::setFormat(getArgument())) printHelp(); }
+        else if (!strcmp(arg, "--changed-only")) stream::changedOnly = true;
+        else if (!strcmp(arg, "--flush-interval")) stream::flushInterval = atoi(getArgument());
+        else if (!strcmp(arg, "--record")) recordFile = getArgument();
+        else if (!strcmp(arg, "--dump-record")) return tslog::cli::dump(getArgument()) ? 0 : 1;
+        else if (!strcmp(arg, "--query")) queryFiles = getArgument();
+        else if (!strcmp(arg, "--query-metrics")) copystr(query::metrics, getArgument());
+        else if (!strcmp(arg, "--query-from")) { if (!query::parseTime(getArgument(), query::from)) printHelp(); }
+        else if (!strcmp(arg, "--query-to")) { if (!query::parseTime(getArgument(), query::to)) printHelp(); }
+        else if (!strcmp(arg, "--query-band")) query::band = strtoull(getArgument(), nullptr, 10);
+        else if (!strcmp(arg, "--query-cell")) query::cell = strtoull(getArgument(), nullptr, 16);
+        else if (!strcmp(arg, "--query-threshold")) query::threshold = atof(getArgument());
+        else if (!strcmp(arg, "--query-per-file")) query::perFile = true;
+        else if (!strcmp(arg, "--db")) dbFile = getArgument();
+        else if (!strcmp(arg, "--shm")) copystr(shm::name, getArgument());
+        else if (!strcmp(arg, "--checkpoint")) copystr(checkpoint::path, getArgument());
+        else if (!strcmp(arg, "--exporter"))
+        {
+            exporter::port = atoi(getArgument());
+            exportMetrics = true;
+        }
         else if (!strcmp(arg, "--relay")) relayRequest = getArgument();
         else if (!strcmp(arg, "--relay-post-data")) relayPostData = getArgument();
         else if (!strcmp(arg, "--relay-loop")) relayLoop = true;
@@ -245,11 +416,57 @@ int main(int argc, char **argv)
 #ifdef WORK_IN_PROGRESS
         else if (!strcmp(arg, "--show-at-tcp-signal-strength")) showAtTcpSignalStrength = true;
         else if (!strcmp(arg, "--at-tcp-signal-strength-columns")) copystr(at_tcp::cli::columns, getArgument());
+        else if (!strcmp(arg, "--at-tcp-command")) atTcpCommand = getArgument();
+        else if (!strcmp(arg, "--at-serial")) copystr(at_tcp::serialDevice, getArgument());
+        else if (!strcmp(arg, "--antenna-alignment")) antennaAlignment = true;
+        else if (!strcmp(arg, "--hybrid-signal-source")) hybrid::enabled = true;
+        else if (!strcmp(arg, "--at-tcp-proxy"))
+        {
+            proxy::port = atoi(getArgument());
+            runProxy = true;
+        }
+        else if (!strcmp(arg, "--at-tcp-proxy-bind")) copystr(proxy::bindAddress, getArgument());
+        else if (!strcmp(arg, "--at-tcp-proxy-pty"))
+        {
+            copystr(proxy::ptyLink, getArgument());
+            runProxy = true;
+        }
 #endif
         else printHelp();
     }
 
-    if (showAtTcpSignalStrength)
+    if (queryFiles) return query::cli::run(queryFiles) ? 0 : 1;
+
+    if (showSignalStrength || showTraffic || showAtTcpSignalStrength || exportMetrics)
+    {
+        if (!recordFile && tslog::path[0]) recordFile = tslog::path;
+        if (recordFile && !tslog::open(recordFile)) exit_error(false);
+    }
+
+    bool dbOpen = false;
+
+    if (showSignalStrength || showTraffic || showWlanClients || showAtTcpSignalStrength || exportMetrics)
+    {
+        if (!dbFile && db::path[0]) dbFile = db::path;
+
+        if (dbFile)
+        {
+            if (!db::open(dbFile)) exit_error(false);
+            dbOpen = true;
+        }
+
+        if (exporter::port > 0 && !exporter::start(exporter::port)) exit_error(false);
+        if (shm::name[0] && !shm::open(shm::name)) exit_error(false);
+        if (checkpoint::path[0]) checkpoint::restore(checkpoint::path);
+        pipeline::start();
+    }
+
+    // Only the database reads the rollup buckets
+    if (!dbOpen) rollup_tiers::count = 0;
+
+    const bool useAtTcp = showAtTcpSignalStrength || atTcpCommand || runProxy || antennaAlignment;
+
+    if (useAtTcp)
     {
         at_tcp::init();
 
@@ -267,10 +484,33 @@ int main(int argc, char **argv)
         } while (!checkExit());
 
         connected:;
-        #warning reconnect
+        // Later drops are reconnected by at_tcp::process()
         dbg.linef("Connected successfully");
+
+        // Shares the connection while the tool itself uses it as well
+        if (!atTcpCommand && (proxy::port > 0 || proxy::ptyLink[0]) && !proxy::start())
+            exit_error(false);
+    }
+
+    // Hybrid signal source: AT in addition to the web API, a failed
+    // connect is retried by at_tcp::process(), web values fill the gap
+
+    if (showSignalStrength && hybrid::enabled && !useAtTcp)
+    {
+        at_tcp::init();
+
+        if (at_tcp::connect() == at_tcp::AT_TCP_Error::COULD_NOT_RESOLVE_HOSTNAME)
+            exit_error(false);
     }
     else
+    {
+        hybrid::enabled = false;
+    }
+
+    // Alert actions such as reconnect go through the web API
+    // in AT mode as well
+
+    if (!useAtTcp || ((showAtTcpSignalStrength || runProxy) && alerts::needsWeb()))
     {
         if (plmn && (!plmnRat || !plmnMode)) printHelp();
         if (networkMode && (!networkBand || !lteBand)) printHelp();
@@ -364,6 +604,12 @@ int main(int argc, char **argv)
         printSuccess = false;
         printError = false;
     }
+    else if (exportMetrics)
+    {
+        rc = web::cli::exportMetrics();
+        printSuccess = false;
+        printError = false;
+    }
     else if (connect || disconnect)
     {
         rc = connect ? web::cli::connect() : web::cli::disconnect();
@@ -376,6 +622,24 @@ int main(int argc, char **argv)
         printSuccess = true;
         printError = true;
     }
+    else if (antennaAlignment)
+    {
+        rc = align::cli::run();
+        printSuccess = false;
+        printError = false;
+    }
+    else if (runProxy)
+    {
+        rc = proxy::cli::run();
+        printSuccess = false;
+        printError = false;
+    }
+    else if (atTcpCommand)
+    {
+        rc = at_tcp::cli::runCommand(atTcpCommand);
+        printSuccess = false;
+        printError = false;
+    }
     else if (showAtTcpSignalStrength)
     {
         rc = at_tcp::cli::showSignalStrength();
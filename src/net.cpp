@@ -0,0 +1,513 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+// winsock2.h has to come before anything pulling in windows.h
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600 // WSAPoll
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include "net.h"
+#include "tools.h"
+
+#ifdef NET_USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+
+namespace net {
+
+namespace {
+
+#ifdef _WIN32
+typedef WSAPOLLFD PollFd;
+typedef int SockLen;
+
+int getLastError() { return WSAGetLastError(); }
+bool isWouldBlock(int error) { return error == WSAEWOULDBLOCK; }
+bool isInProgress(int error) { return error == WSAEWOULDBLOCK || error == WSAEINPROGRESS; }
+int doPoll(PollFd *fds, size_t count, int timeout) { return WSAPoll(fds, (ULONG)count, timeout); }
+void closeSocket(Socket sock) { closesocket(sock); }
+
+bool setNonBlocking(Socket sock)
+{
+    u_long mode = 1;
+    return !ioctlsocket(sock, FIONBIO, &mode);
+}
+#else
+typedef pollfd PollFd;
+typedef socklen_t SockLen;
+
+int getLastError() { return errno; }
+bool isWouldBlock(int error) { return error == EAGAIN || error == EWOULDBLOCK; }
+bool isInProgress(int error) { return error == EINPROGRESS; }
+void closeSocket(Socket sock) { ::close(sock); }
+
+int doPoll(PollFd *fds, size_t count, int timeout)
+{
+    const int rc = poll(fds, count, timeout);
+    return rc < 0 && errno == EINTR ? 0 : rc;
+}
+
+bool setNonBlocking(Socket sock)
+{
+    const int flags = fcntl(sock, F_GETFL, 0);
+    return flags != -1 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+#endif
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+Socket openSocket(int family)
+{
+    Socket sock = (Socket)socket(family, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCK) return INVALID_SOCK;
+
+    if (!setNonBlocking(sock))
+    {
+        closeSocket(sock);
+        return INVALID_SOCK;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    return sock;
+}
+
+int waitFor(Socket sock, short events, unsigned timeout)
+{
+    PollFd fd;
+    fd.fd = sock;
+    fd.events = events;
+    fd.revents = 0;
+
+    const int rc = doPoll(&fd, 1, (int)timeout);
+    if (rc <= 0) return rc;
+
+    return fd.revents & (events | POLLERR | POLLHUP) ? 1 : 0;
+}
+
+} // anonymous namespace
+
+bool init()
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    return !WSAStartup(MAKEWORD(2, 2), &wsaData);
+#else
+    return true;
+#endif
+}
+
+void deinit()
+{
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+const char *getError()
+{
+#ifdef _WIN32
+    static char buf[32];
+    snprintf(buf, sizeof(buf), "Socket error %d", WSAGetLastError());
+    return buf;
+#else
+    return strerror(errno);
+#endif
+}
+
+bool resolve(const char *host, int port, std::vector<Address> &addresses)
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+
+    addrinfo *result = nullptr;
+
+    if (getaddrinfo(host, service, &hints, &result) || !result) return false;
+
+    static_assert(sizeof(sockaddr_storage) <= sizeof(Address::data), "Address too small");
+
+    addresses.clear();
+
+    for (addrinfo *addr = result; addr; addr = addr->ai_next)
+    {
+        if (addr->ai_addrlen > sizeof(sockaddr_storage)) continue;
+
+        Address address;
+        address.family = addr->ai_family;
+        address.length = unsigned(addr->ai_addrlen);
+        memcpy(address.data, addr->ai_addr, addr->ai_addrlen);
+
+        addresses.push_back(address);
+    }
+
+    freeaddrinfo(result);
+
+    return !addresses.empty();
+}
+
+Socket connect(const std::vector<Address> &addresses, unsigned timeout, ConnectError &error)
+{
+    const TimeType deadline = getMilliSeconds() + timeout;
+    Socket sock = INVALID_SOCK;
+
+    error = CONNECT_FAILED;
+
+    for (const Address &address : addresses)
+    {
+        const TimeType time = getMilliSeconds();
+
+        if (time >= deadline)
+        {
+            error = CONNECT_TIMED_OUT;
+            break;
+        }
+
+        sock = startConnect(address);
+        if (sock == INVALID_SOCK) continue;
+
+        const int rc = waitFor(sock, POLLOUT, unsigned(deadline - time));
+
+        if (rc > 0 && finishConnect(sock)) break;
+        if (rc == 0) error = CONNECT_TIMED_OUT;
+
+        closeSocket(sock);
+        sock = INVALID_SOCK;
+    }
+
+    if (sock == INVALID_SOCK) return INVALID_SOCK;
+
+    error = CONNECT_OK;
+    return sock;
+}
+
+Socket startConnect(const Address &address)
+{
+    Socket sock = openSocket(address.family);
+    if (sock == INVALID_SOCK) return INVALID_SOCK;
+
+    sockaddr_storage addr;
+    memcpy(&addr, address.data, address.length);
+
+    if (::connect(sock, (const sockaddr *)&addr, (SockLen)address.length) &&
+        !isInProgress(getLastError()))
+    {
+        closeSocket(sock);
+        return INVALID_SOCK;
+    }
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&one, sizeof(one));
+
+    return sock;
+}
+
+bool finishConnect(Socket sock)
+{
+    int soError = 0;
+    SockLen soErrorLength = sizeof(soError);
+
+    if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (char *)&soError, &soErrorLength)) return false;
+    if (!soError) return true;
+
+#ifdef _WIN32
+    WSASetLastError(soError);
+#else
+    errno = soError;
+#endif
+
+    return false;
+}
+
+Socket listen(int port, const char *address)
+{
+    Address bindAddress;
+
+    if (address && *address)
+    {
+        std::vector<Address> addresses;
+        if (!resolve(address, port, addresses)) return INVALID_SOCK;
+        bindAddress = addresses.front();
+    }
+    else
+    {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons((uint16_t)port);
+
+        bindAddress.family = AF_INET;
+        bindAddress.length = sizeof(addr);
+        memcpy(bindAddress.data, &addr, sizeof(addr));
+    }
+
+    Socket sock = openSocket(bindAddress.family);
+    if (sock == INVALID_SOCK) return INVALID_SOCK;
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&one, sizeof(one));
+
+    if (bind(sock, (const sockaddr *)bindAddress.data, bindAddress.length) || ::listen(sock, 16))
+    {
+        closeSocket(sock);
+        return INVALID_SOCK;
+    }
+
+    return sock;
+}
+
+Socket accept(Socket server)
+{
+    Socket sock = (Socket)::accept(server, nullptr, nullptr);
+    if (sock == INVALID_SOCK) return INVALID_SOCK;
+
+    if (!setNonBlocking(sock))
+    {
+        closeSocket(sock);
+        return INVALID_SOCK;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+    return sock;
+}
+
+void close(Socket &sock)
+{
+    if (sock == INVALID_SOCK) return;
+    closeSocket(sock);
+    sock = INVALID_SOCK;
+}
+
+long recv(Socket sock, char *buf, size_t length)
+{
+    const long rc = (long)::recv(sock, buf, (int)length, 0);
+
+    if (rc > 0) return rc;
+    if (rc < 0 && isWouldBlock(getLastError())) return 0;
+
+#ifndef _WIN32
+    if (!rc) errno = ECONNRESET; // Closed by peer
+#endif
+
+    return -1;
+}
+
+long send(Socket sock, const char *data, size_t length)
+{
+    const long rc = (long)::send(sock, data, (int)length, SEND_FLAGS);
+
+    if (rc >= 0) return rc;
+    return isWouldBlock(getLastError()) ? 0 : -1;
+}
+
+bool sendAll(Socket sock, const char *data, size_t length, unsigned timeout)
+{
+    const TimeType deadline = getMilliSeconds() + timeout;
+
+    while (length)
+    {
+        const long rc = (long)::send(sock, data, (int)length, SEND_FLAGS);
+
+        if (rc > 0)
+        {
+            data += rc;
+            length -= rc;
+            continue;
+        }
+
+        if (rc < 0 && isWouldBlock(getLastError()))
+        {
+            const TimeType time = getMilliSeconds();
+
+            if (time < deadline && waitFor(sock, POLLOUT, unsigned(deadline - time)) > 0)
+                continue;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+int waitReadable(Socket sock, unsigned timeout)
+{
+    return waitFor(sock, POLLIN, timeout);
+}
+
+// Poller
+
+Poller::Poller()
+{
+#ifdef NET_USE_EPOLL
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+}
+
+Poller::~Poller()
+{
+#ifdef NET_USE_EPOLL
+    if (epollFd != -1) ::close(epollFd);
+#endif
+}
+
+bool Poller::add(Socket sock, void *data)
+{
+#ifdef NET_USE_EPOLL
+    if (epollFd == -1) return false;
+
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = sock;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, sock, &event)) return false;
+#endif
+
+    entries.push_back({sock, data, false});
+    return true;
+}
+
+bool Poller::setWantWrite(Socket sock, bool wantWrite)
+{
+    for (Entry &entry : entries)
+    {
+        if (entry.sock != sock) continue;
+        if (entry.wantWrite == wantWrite) return true;
+
+#ifdef NET_USE_EPOLL
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? uint32_t(EPOLLOUT) : 0);
+        event.data.fd = sock;
+
+        if (epoll_ctl(epollFd, EPOLL_CTL_MOD, sock, &event)) return false;
+#endif
+
+        entry.wantWrite = wantWrite;
+        return true;
+    }
+
+    return false;
+}
+
+void Poller::remove(Socket sock)
+{
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->sock != sock) continue;
+
+#ifdef NET_USE_EPOLL
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, sock, nullptr);
+#endif
+
+        entries.erase(it);
+        return;
+    }
+}
+
+int Poller::wait(Event *events, int maxEvents, unsigned timeout)
+{
+#ifdef NET_USE_EPOLL
+    epoll_event epollEvents[64];
+    if (maxEvents > 64) maxEvents = 64;
+
+    const int rc = epoll_wait(epollFd, epollEvents, maxEvents, (int)timeout);
+
+    if (rc < 0) return errno == EINTR ? 0 : -1;
+
+    int count = 0;
+
+    for (int i = 0; i < rc; i++)
+    {
+        for (const Entry &entry : entries)
+        {
+            if (entry.sock != epollEvents[i].data.fd) continue;
+
+            const uint32_t flags = epollEvents[i].events;
+
+            events[count++] = {entry.sock, entry.data, (flags & EPOLLIN) != 0,
+                               (flags & EPOLLOUT) != 0,
+                               (flags & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) != 0};
+            break;
+        }
+    }
+
+    return count;
+#else
+    std::vector<PollFd> fds(entries.size());
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        fds[i].fd = entries[i].sock;
+        fds[i].events = POLLIN | (entries[i].wantWrite ? POLLOUT : 0);
+        fds[i].revents = 0;
+    }
+
+    const int rc = doPoll(fds.data(), fds.size(), (int)timeout);
+    if (rc <= 0) return rc;
+
+    int count = 0;
+
+    for (size_t i = 0; i < fds.size() && count < maxEvents; i++)
+    {
+        if (!fds[i].revents) continue;
+
+        events[count++] = {entries[i].sock, entries[i].data, (fds[i].revents & POLLIN) != 0,
+                           (fds[i].revents & POLLOUT) != 0,
+                           (fds[i].revents & (POLLHUP | POLLERR)) != 0};
+    }
+
+    return count;
+#endif
+}
+
+} // namespace net
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __NET_H__
+#define __NET_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__)
+#define NET_USE_EPOLL
+#endif
+
+/*
+ * Thin non-blocking TCP layer on native sockets.
+ *
+ * All sockets handed out are non-blocking. A Poller watches any number
+ * of them from one thread (epoll on Linux, poll() elsewhere).
+ */
+
+namespace net {
+
+#ifdef _WIN32
+typedef uintptr_t Socket; // SOCKET
+#else
+typedef int Socket;
+#endif
+
+constexpr Socket INVALID_SOCK = Socket(-1);
+
+enum ConnectError
+{
+    CONNECT_OK,
+    CONNECT_FAILED,
+    CONNECT_TIMED_OUT
+};
+
+// Resolved once, so that reconnects don't have to block on it again
+struct Address
+{
+    int family;
+    unsigned length;
+    unsigned char data[128]; // sockaddr_storage
+};
+
+bool init();
+void deinit();
+
+const char *getError();
+
+// Resolves host (blocking), addresses in the order to try them
+bool resolve(const char *host, int port, std::vector<Address> &addresses);
+// Connects to the first address that accepts within timeout milliseconds
+Socket connect(const std::vector<Address> &addresses, unsigned timeout, ConnectError &error);
+
+// Connecting without waiting: the socket reports writable (or hangup)
+// once done, finishConnect() then tells if it succeeded
+Socket startConnect(const Address &address);
+bool finishConnect(Socket sock);
+// Listens on all IPv4 addresses unless an address is given
+Socket listen(int port, const char *address = nullptr);
+Socket accept(Socket server);
+void close(Socket &sock);
+
+// Bytes received, 0 if nothing is pending, -1 on error or close
+long recv(Socket sock, char *buf, size_t length);
+// Bytes sent, 0 if the socket is full, -1 on error
+long send(Socket sock, const char *data, size_t length);
+// Waits while the socket is full, up to timeout milliseconds in total
+bool sendAll(Socket sock, const char *data, size_t length, unsigned timeout);
+
+// 1 if readable, 0 on timeout, -1 on error
+int waitReadable(Socket sock, unsigned timeout);
+
+class Poller
+{
+public:
+    struct Event
+    {
+        Socket sock;
+        void *data;
+        bool readable;
+        bool writable;
+        bool hangup;
+    };
+
+    Poller();
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller &operator=(const Poller&) = delete;
+
+    bool add(Socket sock, void *data);
+    // Also report the socket as writable, until switched off again
+    bool setWantWrite(Socket sock, bool wantWrite);
+    void remove(Socket sock);
+    size_t size() const { return entries.size(); }
+
+    // Number of events, 0 on timeout, -1 on error
+    int wait(Event *events, int maxEvents, unsigned timeout);
+
+private:
+    struct Entry
+    {
+        Socket sock;
+        void *data;
+        bool wantWrite;
+    };
+
+    std::vector<Entry> entries;
+#ifdef NET_USE_EPOLL
+    int epollFd;
+#endif
+};
+
+} // namespace net
+
+#endif // __NET_H__
@@ -0,0 +1,268 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "pipeline.h"
+#include "spsc_ring.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+#include "tslog.h"
+#include "stream.h"
+#include "db.h"
+#include "exporter.h"
+#include "shm.h"
+#include "checkpoint.h"
+#include "alerts.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace pipeline {
+
+namespace {
+
+constexpr size_t INPUT_SIZE = 64;
+constexpr size_t QUEUE_SIZE = 32;
+constexpr size_t MAX_SINKS = 2;
+
+// Ring plus wakeups, the mutex only guards sleeping,
+// never the samples.
+
+template<size_t N>
+struct Channel
+{
+    SpscRing<Sample, N> ring;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    void notify()
+    {
+        {
+            // Orders the wakeup after a consumer that
+            // found the ring empty went to sleep
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        cond.notify_one();
+    }
+
+    // Null once stopped and drained
+    const Sample *wait(const std::atomic<bool> &stop)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const Sample *sample;
+
+        while (!(sample = ring.front()))
+        {
+            if (stop) return nullptr;
+            cond.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        return sample;
+    }
+};
+
+struct Sink
+{
+    const char *name;
+    Policy policy;
+    void (*consume)(const Sample &sample);
+    Channel<QUEUE_SIZE> channel;
+    std::thread thread;
+    std::atomic<unsigned long long> dropped{0};
+};
+
+// Static, the rings are cache line aligned
+
+Channel<INPUT_SIZE> input;
+Sink sinks[MAX_SINKS];
+size_t numSinks = 0;
+std::thread dispatcher;
+std::atomic<bool> stopDispatcher{false};
+std::atomic<bool> stopSinks{false};
+std::atomic<unsigned long long> dropped{0};
+unsigned long long eventCursor = 0;
+bool running = false;
+
+void copySample(Sample &dst, const Sample &src)
+{
+    dst.time = src.time;
+    dst.band = src.band;
+    dst.cell = src.cell;
+    dst.numValues = src.numValues;
+    dst.numEvents = src.numEvents;
+    std::copy(src.values, src.values + src.numValues, dst.values);
+    std::copy(src.events, src.events + src.numEvents, dst.events);
+}
+
+void dispatch()
+{
+    const Sample *sample;
+
+    while ((sample = input.wait(stopDispatcher)))
+    {
+        for (size_t i = 0; i < numSinks; i++)
+        {
+            Sink &sink = sinks[i];
+            Sample *slot;
+
+            while (!(slot = sink.channel.ring.beginPush()) && sink.policy == BLOCK)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            if (!slot)
+            {
+                sink.dropped++;
+                continue;
+            }
+
+            copySample(*slot, *sample);
+            sink.channel.ring.commitPush();
+            sink.channel.notify();
+        }
+
+        input.ring.pop();
+    }
+}
+
+void consume(Sink &sink)
+{
+    const Sample *sample;
+
+    while ((sample = sink.channel.wait(stopSinks)))
+    {
+        sink.consume(*sample);
+        sink.channel.ring.pop();
+    }
+}
+
+void addSink(const char *name, const Policy policy, void (*consume)(const Sample &sample))
+{
+    Sink &sink = sinks[numSinks++];
+    sink.name = name;
+    sink.policy = policy;
+    sink.consume = consume;
+    sink.dropped = 0;
+}
+
+} // anonymous namespace
+
+void start()
+{
+    if (running) return;
+
+    // The record file must be complete and is fast to write,
+    // a stalled stdout reader must not hold it back.
+
+    if (tslog::isOpen()) addSink("record", BLOCK, tslog::record);
+    if (stream::isEnabled()) addSink("stream", DROP, stream::record);
+
+    if (!numSinks) return;
+
+    stopDispatcher = false;
+    stopSinks = false;
+
+    for (size_t i = 0; i < numSinks; i++) sinks[i].thread = std::thread(consume, std::ref(sinks[i]));
+    dispatcher = std::thread(dispatch);
+
+    running = true;
+}
+
+void publish()
+{
+    if (!running) return;
+
+    Sample *sample = input.ring.beginPush();
+
+    if (!sample)
+    {
+        // Events stay pending for the next sample
+        dropped++;
+        return;
+    }
+
+    sample->time = getUnixMilliSeconds();
+    sample->band = sig.band;
+    sample->cell = sig.cell;
+    sample->numValues = 0;
+    sample->numEvents = 0;
+
+    forEachMetric([&](const Metric &metric)
+    {
+        if (!metric.count || sample->numValues == MAX_VALUES) return;
+        sample->values[sample->numValues++] = {metric.name, metric.val, metric.count};
+    });
+
+    // The rest go out with the next sample
+    events::forEachSince(eventCursor, [&](const events::Event &event)
+    {
+        if (sample->numEvents == MAX_EVENTS) return false;
+        sample->events[sample->numEvents++] = event;
+        return true;
+    });
+
+    input.ring.commitPush();
+    input.notify();
+}
+
+void stop()
+{
+    if (!running) return;
+
+    stopDispatcher = true;
+    input.notify();
+    dispatcher.join();
+
+    stopSinks = true;
+
+    for (size_t i = 0; i < numSinks; i++)
+    {
+        Sink &sink = sinks[i];
+
+        sink.channel.notify();
+        sink.thread.join();
+
+        if (sink.dropped)
+            warn.linef("Dropped %llu samples of the %s output", sink.dropped.load(), sink.name);
+    }
+
+    if (dropped) warn.linef("Dropped %llu samples, the pipeline was busy", dropped.load());
+
+    numSinks = 0;
+    running = false;
+}
+
+void onSample()
+{
+    publish();
+    db::record();
+    exporter::update();
+    shm::update();
+    checkpoint::update();
+    alerts::evaluate();
+}
+
+unsigned long long getDropped()
+{
+    unsigned long long total = dropped;
+    for (size_t i = 0; i < numSinks; i++) total += sinks[i].dropped;
+    return total;
+}
+
+} // namespace pipeline
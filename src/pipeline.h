@@ -0,0 +1,85 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "tools.h"
+#include "events.h"
+
+#include <cstdint>
+
+/*
+ * Fan-out of timestamped samples to the sinks that do slow I/O
+ * (record file, stream output), so a slow terminal or disk never
+ * delays the next poll.
+ *
+ *   publish() --> SPSC ring --> dispatcher thread --+--> queue --> tslog thread
+ *                                                   +--> queue --> stream thread
+ *
+ * Every sink has its own bounded queue and policy: DROP discards
+ * samples the sink can't keep up with, BLOCK holds the dispatcher
+ * until there is room. publish() itself never blocks, it drops the
+ * sample if the dispatcher is behind.
+ *
+ * Sinks must only use the sample, the global signal state belongs
+ * to the polling thread.
+ */
+
+namespace pipeline {
+
+constexpr size_t MAX_VALUES = 64;
+constexpr size_t MAX_EVENTS = 16;
+
+struct Sample
+{
+    struct Value
+    {
+        const char *name; // Static
+        double val;
+        size_t count; // Only increases when the value has changed
+    };
+
+    unsigned long long time; // Unix time in milliseconds
+    XMLNumType band;
+    XMLNumType cell;
+    uint16_t numValues;
+    uint16_t numEvents;
+    Value values[MAX_VALUES];
+    events::Event events[MAX_EVENTS];
+};
+
+enum Policy
+{
+    DROP,
+    BLOCK
+};
+
+void start(); // Starts the enabled sinks, no-op without any
+void publish();
+void stop();  // Drains all queues
+
+// Hands a freshly polled sample to every sink: the pipeline, database,
+// exporter, shared memory, checkpoint and alert rules
+void onSample();
+
+unsigned long long getDropped();
+
+} // namespace pipeline
+
+#endif // __PIPELINE_H__
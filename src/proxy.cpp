@@ -0,0 +1,468 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifdef WORK_IN_PROGRESS
+
+#include "proxy.h"
+#include "at_tcp.h"
+#include "net.h"
+#include "line_buffer.h"
+#include "tools.h"
+#include "cli_tools.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+namespace proxy {
+
+int port = 0;
+char bindAddress[64] = "127.0.0.1"; // Anyone who can connect can send AT commands
+char ptyLink[256] = "";
+
+namespace {
+
+constexpr size_t MAX_CLIENTS = 32;
+constexpr size_t MAX_OUTPUT_BUFFER = 64 * 1024;
+constexpr size_t MAX_PENDING_COMMANDS = 8;
+constexpr unsigned COMMAND_TIMEOUT = 10 * oneSecond;
+
+struct Client
+{
+    unsigned id;
+    net::Socket sock;
+    bool pty;
+    LineBuffer<1024> input;
+    std::string output;
+    size_t pendingCommands = 0;
+    uint64_t droppedLines = 0;
+    bool wantWrite = false;
+};
+
+net::Socket server = net::INVALID_SOCK;
+std::vector<std::unique_ptr<Client>> clients;
+unsigned nextClientId = 1;
+std::vector<std::string> commands; // Of the last read, reused
+
+#ifndef _WIN32
+int ptySlave = -1; // Held open, the master would hang up without a reader
+#endif
+
+Client *findClient(net::Socket sock)
+{
+    for (auto &client : clients)
+        if (client->sock == sock) return client.get();
+
+    return nullptr;
+}
+
+Client *findClient(unsigned id)
+{
+    for (auto &client : clients)
+        if (client->id == id) return client.get();
+
+    return nullptr;
+}
+
+// False if the client is gone
+
+bool closeClient(Client *client)
+{
+    if (client->pty)
+    {
+        // Stays open, the next reader of the terminal is the next client
+        client->output.clear();
+        return true;
+    }
+
+    at_tcp::unwatch(client->sock);
+
+    dbg.linef("Proxy client %u disconnected (%llu lines dropped)",
+              client->id, (unsigned long long)client->droppedLines);
+
+    net::close(client->sock);
+
+    clients.erase(std::find_if(clients.begin(), clients.end(),
+                               [client](const std::unique_ptr<Client> &c) { return c.get() == client; }));
+
+    return false;
+}
+
+long clientRecv(Client *client, char *buf, size_t length)
+{
+#ifndef _WIN32
+    if (client->pty)
+    {
+        const long rc = (long)::read(client->sock, buf, length);
+        if (rc > 0) return rc;
+        return rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EIO) ? 0 : -1;
+    }
+#endif
+
+    return net::recv(client->sock, buf, length);
+}
+
+long clientSend(Client *client, const char *data, size_t length)
+{
+#ifndef _WIN32
+    if (client->pty)
+    {
+        const long rc = (long)::write(client->sock, data, length);
+        if (rc >= 0) return rc;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+#endif
+
+    return net::send(client->sock, data, length);
+}
+
+// False if the client has gone away
+
+bool flush(Client *client)
+{
+    while (!client->output.empty())
+    {
+        const long sent = clientSend(client, client->output.data(), client->output.length());
+
+        if (sent < 0) return false;
+        if (!sent) break;
+
+        client->output.erase(0, sent);
+    }
+
+    const bool wantWrite = !client->output.empty();
+
+    if (wantWrite != client->wantWrite)
+    {
+        at_tcp::setWantWrite(client->sock, wantWrite);
+        client->wantWrite = wantWrite;
+    }
+
+    return true;
+}
+
+// False if the client is gone
+
+bool sendLine(Client *client, const char *line, size_t length)
+{
+    // V.25ter framing: <CR><LF>line<CR><LF>
+
+    if (client->output.length() + length + 4 > MAX_OUTPUT_BUFFER)
+    {
+        if (!client->droppedLines++)
+            warn.linef("Proxy client %u doesn't keep up, dropping lines", client->id);
+        return true;
+    }
+
+    client->output += "\r\n";
+    client->output.append(line, length);
+    client->output += "\r\n";
+
+    if (!client->wantWrite && !flush(client)) return closeClient(client);
+    return true;
+}
+
+bool sendLine(Client *client, const char *line)
+{
+    return sendLine(client, line, strlen(line));
+}
+
+void broadcast(const char *line, size_t length)
+{
+    // sendLine() may remove clients
+
+    for (size_t i = clients.size(); i--;)
+    {
+        if (i < clients.size()) sendLine(clients[i].get(), line, length);
+    }
+}
+
+void handleCommand(Client *client, const char *command)
+{
+    if (client->pendingCommands >= MAX_PENDING_COMMANDS)
+    {
+        sendLine(client, "ERROR");
+        return;
+    }
+
+    const unsigned id = client->id;
+
+    auto respond = [id](const at_tcp::CommandResponse &response)
+    {
+        Client *client = findClient(id);
+        if (!client) return;
+
+        client->pendingCommands--;
+
+        for (const std::string &line : response.lines)
+            if (!sendLine(client, line.c_str(), line.length())) return;
+
+        // Timeouts and disconnects look like any other failure to the client
+        sendLine(client, response.finalResult[0] ? response.finalResult : "ERROR");
+    };
+
+    if (!at_tcp::sendCommand(command, COMMAND_TIMEOUT, respond))
+    {
+        sendLine(client, "ERROR");
+        return;
+    }
+
+    client->pendingCommands++;
+}
+
+void handleClientEvent(const net::Poller::Event &event)
+{
+    Client *client = findClient(event.sock);
+    if (!client) return;
+
+    if (event.writable && !flush(client))
+    {
+        closeClient(client);
+        return;
+    }
+
+    if (!event.readable && !event.hangup) return;
+
+    for (;;)
+    {
+        const long recvLength = clientRecv(client, client->input.getWritePtr(),
+                                           client->input.getWritable());
+
+        if (!recvLength) break;
+
+        if (recvLength < 0)
+        {
+            closeClient(client);
+            return;
+        }
+
+        // Terminals end commands with CR only
+
+        char *data = client->input.getWritePtr();
+        std::replace(data, data + recvLength, '\r', '\n');
+
+        // Commands are handled once commit() is done with the buffer,
+        // an answer may close the client and free it
+
+        commands.clear();
+
+        client->input.commit(recvLength, [](const char *line, size_t length)
+        {
+            if (length) commands.emplace_back(line, length);
+        });
+
+        const unsigned id = client->id;
+
+        for (const std::string &command : commands)
+        {
+            handleCommand(client, command.c_str());
+            if (!(client = findClient(id))) return;
+        }
+    }
+}
+
+void handleServerEvent(const net::Poller::Event &event)
+{
+    if (!event.readable) return;
+
+    net::Socket sock;
+
+    while ((sock = net::accept(server)) != net::INVALID_SOCK)
+    {
+        if (clients.size() >= MAX_CLIENTS)
+        {
+            warn.linef("Proxy: Too many clients");
+            net::close(sock);
+            continue;
+        }
+
+        std::unique_ptr<Client> client(new Client);
+        client->id = nextClientId++;
+        client->sock = sock;
+        client->pty = false;
+
+        if (!at_tcp::watch(sock, handleClientEvent))
+        {
+            net::close(sock);
+            continue;
+        }
+
+        dbg.linef("Proxy client %u connected", client->id);
+        clients.push_back(std::move(client));
+    }
+}
+
+bool openPty()
+{
+#ifdef _WIN32
+    err.linef("Proxy: Pseudo terminals are not supported on Windows");
+    return false;
+#else
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master == -1 || grantpt(master) || unlockpt(master))
+    {
+        err.linef("Proxy: Could not create a pseudo terminal: %s", strerror(errno));
+        if (master != -1) ::close(master);
+        return false;
+    }
+
+    const char *slaveName = ptsname(master);
+    ptySlave = slaveName ? ::open(slaveName, O_RDWR | O_NOCTTY) : -1;
+
+    if (ptySlave == -1)
+    {
+        err.linef("Proxy: Could not open %s", slaveName ? slaveName : "pseudo terminal");
+        ::close(master);
+        return false;
+    }
+
+    // Raw, no echo of the commands back into the master
+
+    termios tio;
+    tcgetattr(ptySlave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(ptySlave, TCSANOW, &tio);
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL, 0) | O_NONBLOCK);
+
+    // Only ever replace a previous link, never a file
+
+    struct stat st;
+
+    if (!lstat(ptyLink, &st) && S_ISLNK(st.st_mode)) unlink(ptyLink);
+
+    if (symlink(slaveName, ptyLink))
+    {
+        err.linef("Proxy: Could not link %s to %s: %s", ptyLink, slaveName, strerror(errno));
+        ::close(ptySlave);
+        ptySlave = -1;
+        ::close(master);
+        return false;
+    }
+
+    std::unique_ptr<Client> client(new Client);
+    client->id = nextClientId++;
+    client->sock = master;
+    client->pty = true;
+
+    if (!at_tcp::watch(master, handleClientEvent))
+    {
+        unlink(ptyLink);
+        ::close(ptySlave);
+        ptySlave = -1;
+        ::close(master);
+        return false;
+    }
+
+    info.linef("Proxy: AT terminal at %s (%s)", ptyLink, slaveName);
+    clients.push_back(std::move(client));
+
+    return true;
+#endif
+}
+
+} // anonymous namespace
+
+bool start()
+{
+    if (port > 0)
+    {
+        if ((server = net::listen(port, bindAddress)) == net::INVALID_SOCK)
+        {
+            dbg.linef("%s", net::getError());
+            err.linef("Proxy: Could not listen on %s port %d", *bindAddress ? bindAddress : "*", port);
+            return false;
+        }
+
+        if (!at_tcp::watch(server, handleServerEvent))
+        {
+            net::close(server);
+            return false;
+        }
+
+        info.linef("Proxy: Listening on %s port %d", *bindAddress ? bindAddress : "*", port);
+    }
+
+    if (ptyLink[0] && !openPty())
+    {
+        stop();
+        return false;
+    }
+
+    at_tcp::setURCHandler(broadcast);
+
+    return true;
+}
+
+void stop()
+{
+    at_tcp::setURCHandler(nullptr);
+
+    while (!clients.empty())
+    {
+        Client *client = clients.back().get();
+        at_tcp::unwatch(client->sock);
+        net::close(client->sock);
+        clients.pop_back();
+    }
+
+#ifndef _WIN32
+    if (ptySlave != -1)
+    {
+        unlink(ptyLink);
+        ::close(ptySlave);
+        ptySlave = -1;
+    }
+#endif
+
+    if (server != net::INVALID_SOCK)
+    {
+        at_tcp::unwatch(server);
+        net::close(server);
+    }
+}
+
+namespace cli {
+using namespace ::cli;
+
+bool run()
+{
+    do
+    {
+        if (!at_tcp::process(50)) return false;
+    } while (!checkExit());
+
+    return true;
+}
+
+} // namespace cli
+
+} // namespace proxy
+
+#endif
@@ -0,0 +1,51 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __PROXY_H__
+#define __PROXY_H__
+
+#ifdef WORK_IN_PROGRESS
+
+/*
+ * Shares the single AT connection of the router with local clients,
+ * over TCP and/or a pseudo terminal.
+ *
+ * URCs are broadcast to every client, commands are queued on the
+ * AT command channel and only the sender gets the response. Every
+ * client has a bounded output buffer, a client that doesn't read
+ * loses lines instead of holding up the others.
+ */
+
+namespace proxy {
+
+extern int port;              // 0 disables the TCP listener
+extern char bindAddress[64];  // Of the TCP listener, empty = all addresses
+extern char ptyLink[256];     // Empty disables the pseudo terminal
+
+bool start();
+void stop();
+
+namespace cli {
+bool run();
+} // namespace cli
+
+} // namespace proxy
+
+#endif
+
+#endif // __PROXY_H__
@@ -0,0 +1,594 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "query.h"
+#include "tslog.h"
+#include "cli_tools.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace query {
+
+char metrics[512] = "";
+TimeType from = 0;
+TimeType to = 0;
+XMLNumType band = 0;
+XMLNumType cell = 0;
+double threshold = NAN;
+bool perFile = false;
+
+namespace {
+
+constexpr TimeType MAX_TIME = TimeType(-1);
+
+struct Interval
+{
+    TimeType start;
+    TimeType end; // Exclusive
+};
+
+struct File
+{
+    const char *path;
+    tslog::Reader reader;
+    std::vector<Interval> intervals; // Matching time range, band and cell
+    bool ok = false;
+};
+
+struct Task
+{
+    size_t file;
+    size_t metric;
+    const tslog::Reader::Block *block;
+    TimeType first;
+    TimeType next; // First time of the next block of the series, 0 = end of session
+};
+
+struct Accumulator
+{
+    uint64_t count = 0;
+    double min = INFINITY;
+    double max = -INFINITY;
+    double sum = 0.0;
+    double weightedSum = 0.0; // Of value * milliseconds held
+    double seconds = 0.0;
+    double belowSeconds = 0.0;
+
+    struct Weight
+    {
+        double milliSeconds = 0.0;
+        uint64_t count = 0;
+    };
+
+    // Signal values are quantized, so a histogram
+    // of the distinct values gives exact percentiles
+    std::unordered_map<double, Weight> histogram;
+
+    void merge(const Accumulator &other)
+    {
+        count += other.count;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        sum += other.sum;
+        weightedSum += other.weightedSum;
+        seconds += other.seconds;
+        belowSeconds += other.belowSeconds;
+
+        for (auto &it : other.histogram)
+        {
+            Weight &weight = histogram[it.first];
+            weight.milliSeconds += it.second.milliSeconds;
+            weight.count += it.second.count;
+        }
+    }
+
+    // The logs only hold value changes, so values are weighted by the
+    // time they were held. Records are counted if no time is covered.
+
+    bool isTimeWeighted() const { return seconds > 0.0; }
+
+    double getMean() const
+    {
+        return isTimeWeighted() ? weightedSum / (seconds * 1000.0) : sum / count;
+    }
+
+    void getPercentiles(const double *ps, double *vals, const size_t n) const
+    {
+        std::vector<std::pair<double, Weight>> sorted(histogram.begin(), histogram.end());
+        std::sort(sorted.begin(), sorted.end(), [](
+            const std::pair<double, Weight> &a, const std::pair<double, Weight> &b)
+        {
+            return a.first < b.first;
+        });
+
+        const bool timeWeighted = isTimeWeighted();
+        double total = 0.0;
+
+        for (auto &it : sorted)
+            total += timeWeighted ? it.second.milliSeconds : it.second.count;
+
+        double seen = 0.0;
+        size_t p = 0;
+
+        for (auto &it : sorted)
+        {
+            const double weight = timeWeighted ? it.second.milliSeconds : it.second.count;
+            if (weight <= 0.0) continue;
+
+            seen += weight;
+
+            // Nearest rank, by time held
+            while (p < n && seen >= ps[p] * total)
+                vals[p++] = it.first;
+        }
+
+        while (p < n) vals[p++] = NAN;
+    }
+};
+
+struct ThreadState
+{
+    std::vector<Accumulator> accumulators; // [group * numMetrics + metric]
+    std::vector<TimeType> times;
+    std::vector<double> vals;
+    std::vector<double> durations;
+};
+
+// Runs f(index, thread) for all indices on all cores
+
+template<typename F>
+void parallelFor(const size_t count, const unsigned numThreads, F &&f)
+{
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+
+    auto work = [&](const unsigned thread)
+    {
+        for (size_t i; (i = next++) < count;) f(i, thread);
+    };
+
+    for (unsigned thread = 1; thread < numThreads; thread++) threads.emplace_back(work, thread);
+    work(0);
+
+    for (auto &thread : threads) thread.join();
+}
+
+// The kernels are kept branch free with independent lanes,
+// which lets the compiler vectorize them.
+
+constexpr size_t LANES = 4;
+
+void addMinMaxSum(const double *vals, const size_t n, Accumulator &acc)
+{
+    double min[LANES], max[LANES], sum[LANES];
+    size_t i = 0;
+
+    for (size_t l = 0; l < LANES; l++)
+    {
+        min[l] = acc.min;
+        max[l] = acc.max;
+        sum[l] = 0.0;
+    }
+
+    for (; i + LANES <= n; i += LANES)
+    {
+        for (size_t l = 0; l < LANES; l++)
+        {
+            const double val = vals[i + l];
+            min[l] = val < min[l] ? val : min[l];
+            max[l] = val > max[l] ? val : max[l];
+            sum[l] += val;
+        }
+    }
+
+    for (; i < n; i++)
+    {
+        min[0] = vals[i] < min[0] ? vals[i] : min[0];
+        max[0] = vals[i] > max[0] ? vals[i] : max[0];
+        sum[0] += vals[i];
+    }
+
+    for (size_t l = 0; l < LANES; l++)
+    {
+        acc.min = std::min(acc.min, min[l]);
+        acc.max = std::max(acc.max, max[l]);
+        acc.sum += sum[l];
+    }
+
+    acc.count += n;
+}
+
+// times[n] must be the time of the following sample
+
+void getDurations(const TimeType *times, const size_t n, const TimeType end, double *durations)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        const TimeType next = times[i + 1] < end ? times[i + 1] : end;
+        durations[i] = (double)(next - times[i]);
+    }
+}
+
+double sumBelow(const double *vals, const double *durations, const size_t n, const double threshold)
+{
+    double sum[LANES] = {};
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES)
+        for (size_t l = 0; l < LANES; l++)
+            sum[l] += vals[i + l] < threshold ? durations[i + l] : 0.0;
+
+    for (; i < n; i++) sum[0] += vals[i] < threshold ? durations[i] : 0.0;
+
+    return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+double sumProducts(const double *vals, const double *durations, const size_t n)
+{
+    double sum[LANES] = {};
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES)
+        for (size_t l = 0; l < LANES; l++) sum[l] += vals[i + l] * durations[i + l];
+
+    for (; i < n; i++) sum[0] += vals[i] * durations[i];
+
+    return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+double sum(const double *vals, const size_t n)
+{
+    double sum[LANES] = {};
+    size_t i = 0;
+
+    for (; i + LANES <= n; i += LANES)
+        for (size_t l = 0; l < LANES; l++) sum[l] += vals[i + l];
+
+    for (; i < n; i++) sum[0] += vals[i];
+
+    return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+void addHistogram(const double *vals, const double *durations, const size_t n, Accumulator &acc)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        Accumulator::Weight &weight = acc.histogram[vals[i]];
+        weight.milliSeconds += durations[i];
+        weight.count++;
+    }
+}
+
+// Time spans in which the serving band and cell match the filters
+
+void getIntervals(File &file)
+{
+    const TimeType start = from;
+    const TimeType end = to ? to : MAX_TIME;
+
+    if (!band && !cell)
+    {
+        if (start < end) file.intervals.push_back({start, end});
+        return;
+    }
+
+    struct Change
+    {
+        TimeType time;
+        uint32_t session;
+        bool isCell;
+        XMLNumType val;
+    };
+
+    std::vector<Change> changes;
+    std::vector<TimeType> times;
+    std::vector<double> vals;
+
+    for (auto &block : file.reader.getBlocks())
+    {
+        const bool isCell = *block.name == "cell";
+        if (!isCell && *block.name != "band") continue;
+
+        times.resize(block.count);
+        vals.resize(block.count);
+
+        const size_t n = tslog::Reader::decode(block, times.data(), vals.data());
+
+        for (size_t i = 0; i < n; i++)
+            changes.push_back({times[i], block.session, isCell, (XMLNumType)vals[i]});
+    }
+
+    std::stable_sort(changes.begin(), changes.end(),
+                     [](const Change &a, const Change &b) { return a.time < b.time; });
+
+    XMLNumType currentBand = 0;
+    XMLNumType currentCell = 0;
+    uint32_t session = uint32_t(-1);
+    bool matching = false;
+    TimeType matchStart = 0;
+
+    auto add = [&](const TimeType a, const TimeType b)
+    {
+        const TimeType s = std::max(a, start);
+        const TimeType e = std::min(b, end);
+        if (s < e) file.intervals.push_back({s, e});
+    };
+
+    for (auto &change : changes)
+    {
+        // Band and cell are unknown until seen in a new session
+        if (change.session != session)
+        {
+            session = change.session;
+            currentBand = currentCell = 0;
+        }
+
+        (change.isCell ? currentCell : currentBand) = change.val;
+
+        const bool match = (!band || currentBand == band) && (!cell || currentCell == cell);
+
+        if (match && !matching) matchStart = change.time;
+        else if (!match && matching) add(matchStart, change.time);
+
+        matching = match;
+    }
+
+    if (matching) add(matchStart, MAX_TIME);
+}
+
+void process(const Task &task, const File &file, Accumulator &acc, ThreadState &state)
+{
+    const tslog::Reader::Block &block = *task.block;
+
+    state.times.resize(block.count + 1);
+    state.vals.resize(block.count);
+    state.durations.resize(block.count);
+
+    TimeType *times = state.times.data();
+    double *vals = state.vals.data();
+    double *durations = state.durations.data();
+
+    const size_t n = tslog::Reader::decode(block, times, vals);
+    if (!n) return;
+
+    // The last sample is held until the next block of the
+    // series starts, or doesn't count at the end of a session.
+    times[n] = task.next && n == block.count ? task.next : times[n - 1];
+
+    const std::vector<Interval> &intervals = file.intervals;
+
+    auto it = std::upper_bound(intervals.begin(), intervals.end(), times[0],
+                               [](const TimeType time, const Interval &interval)
+                               { return time < interval.end; });
+
+    for (; it != intervals.end() && it->start <= times[n - 1]; ++it)
+    {
+        const size_t lo = std::lower_bound(times, times + n, it->start) - times;
+        const size_t hi = std::lower_bound(times + lo, times + n, it->end) - times;
+        if (lo == hi) continue;
+
+        const size_t count = hi - lo;
+
+        getDurations(times + lo, count, it->end, durations);
+
+        addMinMaxSum(vals + lo, count, acc);
+        addHistogram(vals + lo, durations, count, acc);
+
+        acc.weightedSum += sumProducts(vals + lo, durations, count);
+        acc.seconds += sum(durations, count) / 1000.0;
+
+        if (!std::isnan(threshold))
+            acc.belowSeconds += sumBelow(vals + lo, durations, count, threshold) / 1000.0;
+    }
+}
+
+} // anonymous namespace
+
+// Unix seconds, "YYYY-MM-DD", "YYYY-MM-DD HH:MM" or "YYYY-MM-DD HH:MM:SS" in local time
+
+bool parseTime(const char *str, TimeType &time)
+{
+    char *end;
+    const unsigned long long seconds = strtoull(str, &end, 10);
+
+    if (end != str && !*end)
+    {
+        time = seconds * 1000;
+        return true;
+    }
+
+    struct tm tm = {};
+    char sep;
+    int n = sscanf(str, "%d-%d-%d%c%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &sep,
+                   &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+
+    if (n != 3 && n != 6 && n != 7) return false;
+    if (n > 3 && sep != ' ' && sep != 'T') return false;
+
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+
+    const time_t t = mktime(&tm);
+    if (t == (time_t)-1) return false;
+
+    time = (TimeType)t * 1000;
+    return true;
+}
+
+namespace cli {
+using namespace ::cli;
+
+bool run(const char *fileList)
+{
+    std::vector<std::string> paths;
+    splitStr(paths, fileList, ",", false);
+
+    if (paths.empty())
+    {
+        err.linef("No files to query");
+        return false;
+    }
+
+    std::vector<File> files(paths.size());
+    const unsigned numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < paths.size(); i++) files[i].path = paths[i].c_str();
+
+    parallelFor(files.size(), std::min<size_t>(numThreads, files.size()),
+                [&](const size_t i, unsigned)
+    {
+        File &file = files[i];
+        file.ok = file.reader.open(file.path);
+        if (file.ok) getIntervals(file);
+    });
+
+    for (auto &file : files)
+    {
+        if (file.ok) continue;
+        err.linef("Could not read %s", file.path);
+        return false;
+    }
+
+    // Metrics
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, size_t> metricIndex;
+
+    if (metrics[0])
+    {
+        splitStr(names, metrics, ",", false);
+        for (auto &name : names) std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    }
+    else
+    {
+        std::map<std::string, bool> seen;
+
+        for (auto &file : files)
+            for (auto &block : file.reader.getBlocks())
+                seen[*block.name] = true;
+
+        for (auto &it : seen)
+        {
+            const std::string &name = it.first;
+            if (name == "band" || name == "cell" || !name.compare(0, 6, "event_")) continue;
+            names.push_back(name);
+        }
+    }
+
+    for (size_t i = 0; i < names.size(); i++) metricIndex[names[i]] = i;
+
+    // Tasks, one per block
+
+    std::vector<Task> tasks;
+
+    for (size_t f = 0; f < files.size(); f++)
+    {
+        std::unordered_map<const std::string*, size_t> lastTask;
+
+        for (auto &block : files[f].reader.getBlocks())
+        {
+            auto metric = metricIndex.find(*block.name);
+            if (metric == metricIndex.end()) continue;
+
+            const TimeType first = tslog::Reader::getFirstTime(block);
+            auto last = lastTask.find(block.name);
+
+            if (last != lastTask.end() && tasks[last->second].block->session == block.session)
+                tasks[last->second].next = first;
+
+            lastTask[block.name] = tasks.size();
+            tasks.push_back({f, metric->second, &block, first, 0});
+        }
+    }
+
+    // Blocks entirely outside of the matching time spans are never decoded
+
+    tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [&](const Task &task)
+    {
+        const std::vector<Interval> &intervals = files[task.file].intervals;
+        if (intervals.empty()) return true;
+        return (task.next && task.next <= intervals.front().start) ||
+               task.first >= intervals.back().end;
+    }), tasks.end());
+
+    const size_t numGroups = perFile ? files.size() : 1;
+    const size_t numTaskThreads = std::max<size_t>(1, std::min<size_t>(numThreads, tasks.size()));
+    std::vector<ThreadState> states(numTaskThreads);
+
+    for (auto &state : states) state.accumulators.resize(numGroups * names.size());
+
+    parallelFor(tasks.size(), numTaskThreads, [&](const size_t i, const unsigned thread)
+    {
+        const Task &task = tasks[i];
+        ThreadState &state = states[thread];
+        const size_t group = perFile ? task.file : 0;
+
+        process(task, files[task.file], state.accumulators[group * names.size() + task.metric], state);
+    });
+
+    for (size_t t = 1; t < states.size(); t++)
+        for (size_t a = 0; a < states[0].accumulators.size(); a++)
+            states[0].accumulators[a].merge(states[t].accumulators[a]);
+
+    // Output
+
+    const bool haveThreshold = !std::isnan(threshold);
+    const double ps[] = {0.05, 0.5, 0.95};
+
+    outf("file,metric,count,min,max,mean,p5,median,p95,seconds%s\n", haveThreshold ? ",below_seconds" : "");
+
+    std::vector<bool> haveSamples(names.size());
+
+    for (size_t g = 0; g < numGroups; g++)
+    {
+        for (size_t m = 0; m < names.size(); m++)
+        {
+            const Accumulator &acc = states[0].accumulators[g * names.size() + m];
+            if (!acc.count) continue;
+
+            haveSamples[m] = true;
+
+            double percentiles[3];
+            acc.getPercentiles(ps, percentiles, 3);
+
+            outf("%s,%s,%llu,%g,%g,%g,%g,%g,%g,%.3f", perFile ? files[g].path : "all", names[m].c_str(),
+                 (unsigned long long)acc.count, acc.min, acc.max, acc.getMean(),
+                 percentiles[0], percentiles[1], percentiles[2], acc.seconds);
+
+            if (haveThreshold) outf(",%.3f", acc.belowSeconds);
+            outf("\n");
+        }
+    }
+
+    for (size_t m = 0; m < names.size(); m++)
+        if (!haveSamples[m]) warn.linef("No matching samples of %s", names[m].c_str());
+
+    return true;
+}
+
+} // namespace cli
+
+} // namespace query
@@ -0,0 +1,55 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __QUERY_H__
+#define __QUERY_H__
+
+#include "tools.h"
+
+/*
+ * Offline queries over one or many signal logs (--record files),
+ * one file per router. Blocks are decoded and aggregated on all cores.
+ *
+ * Output is CSV, one row per metric:
+ *   file,metric,count,min,max,mean,p5,median,p95,seconds[,below_seconds]
+ *
+ * "seconds" is the time covered by the samples, values are held until
+ * the next sample of the series. The logs only record value changes,
+ * so mean and percentiles are weighted by that time, count is the
+ * number of changes. File is "all" unless perFile is set.
+ */
+
+namespace query {
+
+extern char metrics[512];      // Comma separated, empty selects all but events
+extern TimeType from;          // Unix time in milliseconds, 0 = open
+extern TimeType to;            // Unix time in milliseconds, 0 = open
+extern XMLNumType band;        // 0 = any
+extern XMLNumType cell;        // 0 = any
+extern double threshold;       // Time below threshold, NaN disables it
+extern bool perFile;
+
+bool parseTime(const char *str, TimeType &time);
+
+namespace cli {
+bool run(const char *files); // Comma separated
+} // namespace cli
+
+} // namespace query
+
+#endif // __QUERY_H__
@@ -0,0 +1,233 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "serial.h"
+
+#ifndef _WIN32
+#include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+#endif
+
+namespace serial {
+
+#ifdef _WIN32
+
+// The AT stream is waited for with WSAPoll(), which can't take COM
+// port handles
+
+const char *getError()
+{
+    return "Serial ports are not supported on Windows";
+}
+
+Port open(const char *, int)
+{
+    return INVALID_PORT;
+}
+
+void close(Port &port)
+{
+    port = INVALID_PORT;
+}
+
+long read(Port, char *, size_t)
+{
+    return -1;
+}
+
+bool writeAll(Port, const char *, size_t, unsigned)
+{
+    return false;
+}
+
+#else
+
+namespace {
+
+struct BaudRate
+{
+    int rate;
+    speed_t speed;
+};
+
+const BaudRate baudRates[] =
+{
+    { 9600,    B9600    },
+    { 19200,   B19200   },
+    { 38400,   B38400   },
+    { 57600,   B57600   },
+    { 115200,  B115200  },
+    { 230400,  B230400  },
+#ifdef B460800
+    { 460800,  B460800  },
+#endif
+#ifdef B921600
+    { 921600,  B921600  },
+#endif
+};
+
+const char *error = "";
+
+bool fail(const char *what)
+{
+    static char buf[128];
+    snprintf(buf, sizeof(buf), "%s: %s", what, strerror(errno));
+    error = buf;
+    return false;
+}
+
+bool configure(Port port, int baudRate)
+{
+    const BaudRate *baud = nullptr;
+
+    for (const BaudRate &b : baudRates)
+        if (b.rate == baudRate) baud = &b;
+
+    if (!baud)
+    {
+        error = "Unsupported baud rate";
+        return false;
+    }
+
+    termios tio;
+    if (tcgetattr(port, &tio)) return fail("Not a serial port");
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB);
+#ifdef CRTSCTS
+    tio.c_cflag &= ~CRTSCTS;
+#endif
+    // With O_NONBLOCK reads then fail with EAGAIN when nothing is
+    // pending, VMIN 0 would return 0 and look like a hangup
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+
+    if (cfsetispeed(&tio, baud->speed) || cfsetospeed(&tio, baud->speed))
+        return fail("Setting the baud rate failed");
+
+    if (tcsetattr(port, TCSANOW, &tio)) return fail("Configuring the port failed");
+
+    // Whatever the modem sent before is stale
+    tcflush(port, TCIOFLUSH);
+
+#ifdef TIOCEXCL
+    // Keep ModemManager & co. from opening it as well
+    ioctl(port, TIOCEXCL);
+#endif
+
+#if defined(__linux__) && defined(ASYNC_LOW_LATENCY)
+    // Best effort, e.g. ftdi_sio lowers its latency timer to 1 ms
+    serial_struct serialInfo;
+
+    if (!ioctl(port, TIOCGSERIAL, &serialInfo))
+    {
+        serialInfo.flags |= ASYNC_LOW_LATENCY;
+        ioctl(port, TIOCSSERIAL, &serialInfo);
+    }
+#endif
+
+    return true;
+}
+
+} // anonymous namespace
+
+const char *getError()
+{
+    return error;
+}
+
+Port open(const char *device, int baudRate)
+{
+    Port port = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+    if (port == INVALID_PORT)
+    {
+        fail(device);
+        return INVALID_PORT;
+    }
+
+    if (!configure(port, baudRate))
+    {
+        close(port);
+        return INVALID_PORT;
+    }
+
+    return port;
+}
+
+void close(Port &port)
+{
+    if (port == INVALID_PORT) return;
+    ::close(port);
+    port = INVALID_PORT;
+}
+
+long read(Port port, char *buf, size_t length)
+{
+    const long rc = (long)::read(port, buf, length);
+
+    if (rc > 0) return rc;
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+
+    // Unplugged, the other end of a pty closed, ...
+    if (!rc) error = "Port hung up";
+    else fail("Reading failed");
+
+    return -1;
+}
+
+bool writeAll(Port port, const char *data, size_t length, unsigned timeout)
+{
+    while (length)
+    {
+        const long rc = (long)::write(port, data, length);
+
+        if (rc > 0)
+        {
+            data += rc;
+            length -= rc;
+            continue;
+        }
+
+        if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            pollfd fd = {port, POLLOUT, 0};
+            if (poll(&fd, 1, int(timeout)) > 0) continue;
+            error = "Timed out writing";
+            return false;
+        }
+
+        return fail("Writing failed");
+    }
+
+    return true;
+}
+
+#endif
+
+} // namespace serial
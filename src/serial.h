@@ -0,0 +1,48 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __SERIAL_H__
+#define __SERIAL_H__
+
+#include <cstddef>
+
+/*
+ * Serial (USB) modem ports in raw mode, non-blocking like the sockets
+ * of net.h and on POSIX systems watched by the same net::Poller.
+ */
+
+namespace serial {
+
+typedef int Port; // File descriptor
+
+constexpr Port INVALID_PORT = -1;
+
+const char *getError();
+
+// 8N1, no flow control, exclusive access
+Port open(const char *device, int baudRate);
+void close(Port &port);
+
+// > 0 bytes, 0 if nothing is pending, -1 on error or hangup
+long read(Port port, char *buf, size_t length);
+// Waits up to timeout milliseconds whenever the port can't take more
+bool writeAll(Port port, const char *data, size_t length, unsigned timeout);
+
+} // namespace serial
+
+#endif // __SERIAL_H__
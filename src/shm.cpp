@@ -0,0 +1,162 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "shm.h"
+#include "shm_stats.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+
+#include <string>
+
+#ifndef _WIN32
+#include <cerrno>
+#endif
+
+namespace shm {
+
+char name[64] = "";
+
+namespace {
+
+shm_stats::Segment *segment = nullptr;
+shm_stats::Snapshot snapshot;
+std::string segmentName;
+
+uint64_t getRadioValue(const XMLNumType val)
+{
+    return val == __XML_NUM_ERROR__ ? 0 : val;
+}
+
+void fillSnapshot()
+{
+    using x::signal;
+
+    const unsigned long long unixTime = getUnixMilliSeconds();
+    uint32_t numMetrics = 0;
+
+    forEachMetric([&](const Metric &metric)
+    {
+        if (!metric.count || numMetrics == shm_stats::MAX_METRICS) return;
+
+        shm_stats::Metric &m = snapshot.metrics[numMetrics++];
+
+        copystr(m.name, metric.name);
+        m.current = metric.val;
+        metric.get(metric.value, SignalValue<>::GET_MIN, m.min);
+        metric.get(metric.value, SignalValue<>::GET_MAX, m.max);
+        metric.get(metric.value, SignalValue<>::GET_AVERAGE, m.average);
+        m.count = metric.count;
+        m.lastChange = unixTime - getElapsedTime(metric.lastUpdate);
+    });
+
+    snapshot.updateTime = unixTime;
+    snapshot.numMetrics = numMetrics;
+
+    shm_stats::Radio &radio = snapshot.radio;
+
+    radio.plmn = getRadioValue(signal.PLMN);
+    radio.mode = getRadioValue(signal.mode);
+    radio.networkType = getRadioValue(signal.networkTypeEx);
+    radio.band = getRadioValue(signal.band);
+    radio.cell = getRadioValue(signal.cell);
+    radio.dlBandwidth = getRadioValue(signal.DLBW);
+    radio.ulBandwidth = getRadioValue(signal.UPBW);
+    radio.connected = signal.connStatus.isSet() ? (signal.connStatus.isDown() ? 2 : 1) : 0;
+}
+
+} // anonymous namespace
+
+bool open(const char *name_)
+{
+    close();
+
+#ifdef _WIN32
+    (void)name_;
+    err.linef("Shared memory statistics are not supported on Windows");
+    return false;
+#else
+    segmentName = name_;
+    if (segmentName[0] != '/') segmentName.insert(0, 1, '/');
+
+    const int fd = shm_stats::openSegment(segmentName.c_str(), O_CREAT | O_RDWR, 0644);
+
+    if (fd == -1)
+    {
+        err.linef("Could not create shared memory segment %s: %s", segmentName.c_str(), strerror(errno));
+        return false;
+    }
+
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, sizeof(shm_stats::Segment)) == 0)
+        map = mmap(nullptr, sizeof(shm_stats::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        err.linef("Could not map shared memory segment %s: %s", segmentName.c_str(), strerror(errno));
+        shm_stats::unlinkSegment(segmentName.c_str());
+        return false;
+    }
+
+    segment = static_cast<shm_stats::Segment *>(map);
+
+    // Readers check the magic last
+    segment->magic = 0;
+    segment->version = shm_stats::LAYOUT_VERSION;
+    segment->pid = getpid();
+    segment->seq.store(0, std::memory_order_relaxed);
+    memset(&segment->data, 0, sizeof(segment->data));
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->magic = shm_stats::MAGIC;
+
+    dbg.linef("Publishing statistics in shared memory segment %s", segmentName.c_str());
+
+    return true;
+#endif
+}
+
+void update()
+{
+    if (!segment) return;
+
+    fillSnapshot();
+
+    // Seqlock, readers retry while seq is odd or has changed
+
+    const uint32_t seq = segment->seq.load(std::memory_order_relaxed);
+    segment->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(&segment->data, &snapshot, sizeof(snapshot));
+
+    segment->seq.store(seq + 2, std::memory_order_release);
+}
+
+void close()
+{
+#ifndef _WIN32
+    if (!segment) return;
+
+    munmap(segment, sizeof(shm_stats::Segment));
+    shm_stats::unlinkSegment(segmentName.c_str());
+    segment = nullptr;
+#endif
+}
+
+} // namespace shm
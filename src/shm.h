@@ -0,0 +1,38 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __SHM_H__
+#define __SHM_H__
+
+/*
+ * Publishes the current signal values and traffic counters in a
+ * POSIX shared memory segment, see shm_stats.h for the layout
+ * and the reader.
+ */
+
+namespace shm {
+
+extern char name[64]; // Empty disables the segment
+
+bool open(const char *name);
+void update();
+void close();
+
+} // namespace shm
+
+#endif // __SHM_H__
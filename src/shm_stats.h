@@ -0,0 +1,232 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __SHM_STATS_H__
+#define __SHM_STATS_H__
+
+/*
+ * Live statistics published by a running huawei_band_tool
+ * (shm_name / --shm) in a POSIX shared memory segment.
+ *
+ * Header-only, local consumers only need this file:
+ *
+ *   shm_stats::Reader reader;
+ *   shm_stats::Snapshot snapshot;
+ *
+ *   if (reader.open("/huawei_band_tool") && reader.read(snapshot))
+ *   {
+ *       const shm_stats::Metric *sinr = snapshot.find("sinr");
+ *       if (sinr) printf("SINR: %g dB\n", sinr->current);
+ *   }
+ *
+ * The writer updates the segment under a seqlock, read() copies a
+ * consistent snapshot without any system call or lock.
+ * Link with -lrt on older glibc versions. Android has no shm_open(),
+ * there the segment is a file in ANDROID_DIR, mapped the same way.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __ANDROID__
+#include <cstdio>
+#endif
+
+namespace shm_stats {
+
+constexpr uint32_t MAGIC = 0x53535748; // "HWSS"
+constexpr uint32_t LAYOUT_VERSION = 1;
+constexpr size_t MAX_METRICS = 128;
+constexpr size_t NAME_LENGTH = 32;
+constexpr const char *DEFAULT_NAME = "/huawei_band_tool";
+
+// Same names as in record files and the database
+
+struct Metric
+{
+    char name[NAME_LENGTH];
+    double current;
+    double min;
+    double max;
+    double average;
+    uint64_t count;      // Number of changes
+    uint64_t lastChange; // Unix time in milliseconds
+};
+
+// 0 = Unknown
+
+struct Radio
+{
+    uint64_t plmn;
+    uint64_t mode;
+    uint64_t networkType;
+    uint64_t band;
+    uint64_t cell;
+    uint64_t dlBandwidth;
+    uint64_t ulBandwidth;
+    uint32_t connected; // 1 = Connected, 2 = Down
+    uint32_t reserved;
+};
+
+struct Snapshot
+{
+    uint64_t updateTime; // Unix time in milliseconds, 0 = No data yet
+    uint32_t numMetrics;
+    uint32_t reserved;
+    Radio radio;
+    Metric metrics[MAX_METRICS];
+
+    const Metric *find(const char *name) const
+    {
+        for (uint32_t i = 0; i < numMetrics && i < MAX_METRICS; i++)
+            if (!strncmp(metrics[i].name, name, NAME_LENGTH)) return &metrics[i];
+        return nullptr;
+    }
+};
+
+struct Segment
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pid;
+    std::atomic<uint32_t> seq; // Odd while the writer is updating data
+    Snapshot data;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The seqlock needs a lock-free counter");
+
+#ifndef _WIN32
+
+#ifdef __ANDROID__
+
+constexpr const char *ANDROID_DIR = "/data/local/tmp";
+
+inline bool getAndroidPath(const char *name, char (&path)[256])
+{
+    const int length = snprintf(path, sizeof(path), "%s%s%s", ANDROID_DIR, *name == '/' ? "" : "/", name);
+    return length > 0 && (size_t)length < sizeof(path);
+}
+
+inline int openSegment(const char *name, const int flags, const mode_t mode)
+{
+    char path[256];
+    if (!getAndroidPath(name, path)) return -1;
+    return ::open(path, flags, mode);
+}
+
+inline int unlinkSegment(const char *name)
+{
+    char path[256];
+    if (!getAndroidPath(name, path)) return -1;
+    return ::unlink(path);
+}
+
+#else
+
+inline int openSegment(const char *name, const int flags, const mode_t mode)
+{
+    return shm_open(name, flags, mode);
+}
+
+inline int unlinkSegment(const char *name)
+{
+    return shm_unlink(name);
+}
+
+#endif // __ANDROID__
+
+class Reader
+{
+public:
+    bool open(const char *name = DEFAULT_NAME)
+    {
+        close();
+
+        const int fd = openSegment(name, O_RDONLY, 0);
+        if (fd == -1) return false;
+
+        void *map = mmap(nullptr, sizeof(Segment), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (map == MAP_FAILED) return false;
+
+        segment = static_cast<const Segment *>(map);
+
+        if (segment->magic != MAGIC || segment->version != LAYOUT_VERSION)
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close()
+    {
+        if (!segment) return;
+        munmap((void *)segment, sizeof(Segment));
+        segment = nullptr;
+    }
+
+    bool isOpen() const { return segment != nullptr; }
+
+    // Returns false if there is no data yet or the writer
+    // kept updating during all attempts
+    bool read(Snapshot &snapshot, const int maxAttempts = 1000) const
+    {
+        if (!segment) return false;
+
+        for (int attempt = 0; attempt < maxAttempts; attempt++)
+        {
+            const uint32_t seq = segment->seq.load(std::memory_order_acquire);
+            if (seq & 1) continue;
+
+            memcpy(&snapshot, &segment->data, sizeof(snapshot));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (segment->seq.load(std::memory_order_relaxed) == seq)
+                return snapshot.updateTime != 0;
+        }
+
+        return false;
+    }
+
+    // Pid of the writer, the segment stays after it exits uncleanly
+    uint32_t getWriterPid() const { return segment ? segment->pid : 0; }
+
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader &operator=(const Reader&) = delete;
+    ~Reader() { close(); }
+
+private:
+    const Segment *segment = nullptr;
+};
+
+#endif // _WIN32
+
+} // namespace shm_stats
+
+#endif // __SHM_STATS_H__
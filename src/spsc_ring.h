@@ -0,0 +1,81 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Lock-free single producer, single consumer ring buffer.
+ *
+ * The producer fills the slot returned by beginPush() in place and
+ * publishes it with commitPush(), the consumer reads front() and
+ * releases the slot with pop(). Nothing is copied or allocated.
+ */
+
+template<typename T, size_t N>
+class SpscRing
+{
+public:
+    static_assert(N && !(N & (N - 1)), "N must be a power of two");
+
+    // Producer
+
+    T *beginPush()
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == N) return nullptr;
+        return &slots[head & (N - 1)];
+    }
+
+    void commitPush()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer
+
+    const T *front() const
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail) return nullptr;
+        return &slots[tail & (N - 1)];
+    }
+
+    void pop()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Either side, only a snapshot
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Separate cache lines, producer and consumer don't share writes
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    T slots[N];
+};
+
+#endif // __SPSC_RING_H__
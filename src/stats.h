@@ -0,0 +1,513 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include "tools.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+// Sample History
+
+/*
+ * Fixed-capacity ring buffer of timestamped samples with rolling
+ * aggregates over up to MAX_WINDOWS time windows.
+ *
+ * Every window keeps a running mean and variance (Welford, samples
+ * leaving the window are removed in reverse) and a monotonic min/max
+ * queue, so pushing a sample and querying a window is O(1) amortized.
+ * Samples overwritten by the ring buffer drop out of all windows,
+ * so a window never covers more than N samples.
+ */
+
+template <typename T, size_t N = 1024>
+class SampleHistory
+{
+public:
+    static constexpr size_t MAX_WINDOWS = 4;
+
+    static_assert(N && !(N & (N - 1)), "N must be a power of two");
+
+    struct Aggregate
+    {
+        T min;
+        T max;
+        double mean;
+        double m2; // Sum of squared differences from the mean
+        size_t count;
+
+        float avg() const { return count ? mean : 0.f; }
+
+        // Sample standard deviation, same as RunningVariance
+        float stddev() const
+        {
+            if (count < 2) return 0.f;
+            return std::sqrt(std::max(m2, 0.0) / (count - 1));
+        }
+    };
+
+    void push(const TimeType time, const T val,
+              const TimeType *durations, const size_t numWindows)
+    {
+        for (size_t i = 0; i < numWindows && i < MAX_WINDOWS; i++)
+        {
+            Window &w = windows[i];
+            if (w.duration != durations[i]) rebuild(w, durations[i]);
+
+            // The ring buffer is about to overwrite the oldest sample
+            if (w.start != w.end && nextSeq - w.start >= N) evictFront(w);
+        }
+
+        Sample &s = samples[nextSeq & MASK];
+        s.time = time;
+        s.val = val;
+        nextSeq++;
+
+        for (size_t i = 0; i < numWindows && i < MAX_WINDOWS; i++)
+        {
+            Window &w = windows[i];
+            while (w.end != nextSeq) add(w);
+        }
+    }
+
+    bool query(const size_t window, const TimeType duration,
+               const TimeType now, Aggregate &result)
+    {
+        if (window >= MAX_WINDOWS) return false;
+
+        Window &w = windows[window];
+        if (w.duration != duration) rebuild(w, duration);
+
+        while (w.start != w.end && isExpired(w, w.start, now)) evictFront(w);
+        if (w.start == w.end) return false;
+
+        result.min = samples[w.minQueue.front() & MASK].val;
+        result.max = samples[w.maxQueue.front() & MASK].val;
+        result.mean = w.mean;
+        result.m2 = w.m2;
+        result.count = w.end - w.start;
+
+        return true;
+    }
+
+    void reset()
+    {
+        nextSeq = 0;
+
+        for (auto &w : windows)
+        {
+            w.duration = 0; // Rebuilt by the first push() or query()
+            w.clear(0);
+        }
+    }
+
+    SampleHistory() { reset(); }
+
+private:
+    static constexpr size_t MASK = N - 1;
+
+    struct Sample
+    {
+        TimeType time;
+        T val;
+    };
+
+    // Ring of sample sequence numbers
+    struct SeqQueue
+    {
+        uint32_t seqs[N];
+        uint32_t head;
+        uint32_t tail;
+
+        bool empty() const { return head == tail; }
+        uint32_t front() const { return seqs[head & MASK]; }
+        uint32_t back() const { return seqs[(tail - 1) & MASK]; }
+        void pushBack(const uint32_t seq) { seqs[tail++ & MASK] = seq; }
+        void popFront() { head++; }
+        void popBack() { tail--; }
+        void clear() { head = tail = 0; }
+    };
+
+    struct Window
+    {
+        TimeType duration;
+        uint32_t start; // Oldest sample in the window
+        uint32_t end;   // Next sample to be added
+        double mean; // Welford, see RunningVariance
+        double m2;
+        SeqQueue minQueue;
+        SeqQueue maxQueue;
+
+        void clear(const uint32_t seq)
+        {
+            start = end = seq;
+            mean = 0.0;
+            m2 = 0.0;
+            minQueue.clear();
+            maxQueue.clear();
+        }
+    };
+
+    Sample samples[N];
+    Window windows[MAX_WINDOWS];
+    uint32_t nextSeq;
+
+    bool isExpired(const Window &w, const uint32_t seq, const TimeType now) const
+    {
+        return samples[seq & MASK].time + w.duration <= now;
+    }
+
+    void add(Window &w)
+    {
+        const uint32_t seq = w.end++;
+        const T val = samples[seq & MASK].val;
+
+        const double delta = val - w.mean;
+        w.mean += delta / (w.end - w.start);
+        w.m2 += delta * (val - w.mean);
+
+        while (!w.minQueue.empty() && samples[w.minQueue.back() & MASK].val >= val)
+            w.minQueue.popBack();
+
+        while (!w.maxQueue.empty() && samples[w.maxQueue.back() & MASK].val <= val)
+            w.maxQueue.popBack();
+
+        w.minQueue.pushBack(seq);
+        w.maxQueue.pushBack(seq);
+    }
+
+    void evictFront(Window &w)
+    {
+        const uint32_t seq = w.start++;
+
+        const T val = samples[seq & MASK].val;
+
+        // Welford's update in reverse
+        const uint32_t count = w.end - w.start;
+
+        if (!count)
+        {
+            w.mean = 0.0;
+            w.m2 = 0.0;
+        }
+        else
+        {
+            const double delta = val - w.mean;
+            w.mean -= delta / count;
+            w.m2 -= delta * (val - w.mean);
+        }
+
+        if (!w.minQueue.empty() && w.minQueue.front() == seq) w.minQueue.popFront();
+        if (!w.maxQueue.empty() && w.maxQueue.front() == seq) w.maxQueue.popFront();
+    }
+
+    void rebuild(Window &w, const TimeType duration)
+    {
+        // The window has been (re)configured after samples
+        // were recorded, catch up with what is still buffered.
+
+        w.duration = duration;
+        w.clear(nextSeq > N ? nextSeq - N : 0);
+        while (w.end != nextSeq) add(w);
+    }
+};
+
+// Coefficient of variation in percent
+//
+// Only meaningful for values on a ratio scale. For dB values that
+// hover around 0 (SINR, RSRQ, EC/IO) it grows without bound as the
+// mean approaches 0, their StdDev is the better measure.
+
+inline double coefficientOfVariation(const double stddev, const double mean)
+{
+    return mean ? 100.0 * stddev / std::fabs(mean) : 0.0;
+}
+
+// Running Variance
+
+/*
+ * Welford's online algorithm, numerically stable
+ * even after a very large number of samples.
+ */
+
+class RunningVariance
+{
+public:
+    void update(const double x)
+    {
+        count++;
+        const double delta = x - mean;
+        mean += delta / count;
+        m2 += delta * (x - mean);
+    }
+
+    double getMean() const { return mean; }
+    double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+    double stddev() const { return std::sqrt(variance()); }
+
+    double cv() const { return coefficientOfVariation(stddev(), mean); }
+
+    size_t getCount() const { return count; }
+
+    void reset()
+    {
+        count = 0;
+        mean = 0.0;
+        m2 = 0.0;
+    }
+
+    RunningVariance() { reset(); }
+
+private:
+    size_t count;
+    double mean;
+    double m2;
+};
+
+// Streaming Quantiles
+
+/*
+ * P-Square quantile estimator (Jain & Chlamtac, 1985).
+ *
+ * Estimates a single quantile with five markers, memory usage
+ * is constant and an update costs a few comparisons.
+ */
+
+class P2Quantile
+{
+public:
+    void update(const double x)
+    {
+        if (count < 5)
+        {
+            q[count++] = x;
+            if (count == 5) std::sort(q, q + 5);
+            return;
+        }
+
+        int k;
+
+        if (x < q[0])
+        {
+            q[0] = x;
+            k = 0;
+        }
+        else if (x >= q[4])
+        {
+            q[4] = x;
+            k = 3;
+        }
+        else
+        {
+            k = 0;
+            while (k < 3 && x >= q[k + 1]) k++;
+        }
+
+        for (int i = k + 1; i < 5; i++) n[i]++;
+        for (int i = 0; i < 5; i++) np[i] += dn[i];
+
+        for (int i = 1; i <= 3; i++)
+        {
+            const double d = np[i] - n[i];
+
+            if ((d >= 1.0 && n[i + 1] - n[i] > 1) ||
+                (d <= -1.0 && n[i - 1] - n[i] < -1))
+            {
+                const int sign = d > 0 ? 1 : -1;
+                const double qp = parabolic(i, sign);
+
+                if (q[i - 1] < qp && qp < q[i + 1]) q[i] = qp;
+                else q[i] = linear(i, sign);
+
+                n[i] += sign;
+            }
+        }
+
+        count++;
+    }
+
+    double get() const
+    {
+        if (count >= 5) return q[2];
+        if (!count) return 0.0;
+
+        // Not enough samples for the markers yet
+        double sorted[5];
+        std::copy(q, q + count, sorted);
+        std::sort(sorted, sorted + count);
+        return sorted[std::min<size_t>(p * count, count - 1)];
+    }
+
+    size_t getCount() const { return count; }
+
+    void reset(const double p_)
+    {
+        p = p_;
+        count = 0;
+
+        for (int i = 0; i < 5; i++) n[i] = i;
+
+        np[0] = 0.0;
+        np[1] = 2.0 * p;
+        np[2] = 4.0 * p;
+        np[3] = 2.0 + 2.0 * p;
+        np[4] = 4.0;
+
+        dn[0] = 0.0;
+        dn[1] = p / 2.0;
+        dn[2] = p;
+        dn[3] = (1.0 + p) / 2.0;
+        dn[4] = 1.0;
+    }
+
+    P2Quantile(const double p = 0.5) { reset(p); }
+
+private:
+    double p;
+    double q[5];  // Marker heights
+    int n[5];     // Marker positions
+    double np[5]; // Desired marker positions
+    double dn[5]; // Desired position increments
+    size_t count;
+
+    double parabolic(const int i, const int d) const
+    {
+        return q[i] + d / double(n[i + 1] - n[i - 1]) *
+               ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / double(n[i + 1] - n[i]) +
+                (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / double(n[i] - n[i - 1]));
+    }
+
+    double linear(const int i, const int d) const
+    {
+        return q[i] + d * (q[i + d] - q[i]) / double(n[i + d] - n[i]);
+    }
+};
+
+// Rollups
+
+/*
+ * One resolution tier of a rollup: samples are aggregated into
+ * buckets of a fixed interval, aligned to the interval.
+ *
+ * Buckets are closed by the first sample of a later bucket, the
+ * open bucket can be read with getOpen(). Closed buckets are only
+ * kept until they are taken with takeClosed(), the database holds
+ * the history, at most MAX_CLOSED of them wait in memory.
+ */
+
+class RollupTier
+{
+public:
+    struct Bucket
+    {
+        TimeType start;
+        uint32_t count;
+        float min;
+        float max;
+        float mean;
+        float p5;
+        float median;
+        float p95;
+    };
+
+    static constexpr size_t MAX_CLOSED = 8;
+
+    void push(const TimeType time, const double val, const TimeType interval_)
+    {
+        if (interval != interval_) configure(interval_);
+
+        const TimeType start = time - time % interval;
+
+        if (count && start != open.start) close();
+
+        if (!count)
+        {
+            open.start = start;
+            open.min = open.max = val;
+            sum = 0.0;
+            quantiles[0].reset(0.05);
+            quantiles[1].reset(0.5);
+            quantiles[2].reset(0.95);
+        }
+
+        if (val < open.min) open.min = val;
+        if (val > open.max) open.max = val;
+        sum += val;
+        count++;
+        for (auto &quantile : quantiles) quantile.update(val);
+    }
+
+    // Oldest first, appended to buckets
+    void takeClosed(std::vector<Bucket> &buckets)
+    {
+        buckets.insert(buckets.end(), closed.begin(), closed.end());
+        closed.clear();
+    }
+
+    bool getOpen(Bucket &bucket) const
+    {
+        if (!count) return false;
+        bucket = open;
+        fill(bucket);
+        return true;
+    }
+
+    RollupTier() = default;
+
+private:
+    TimeType interval = 0;
+    std::vector<Bucket> closed; // Not taken yet
+
+    Bucket open = {};
+    uint32_t count = 0;
+    double sum = 0.0;
+    P2Quantile quantiles[3]; // P5, Median, P95
+
+    void configure(const TimeType interval_)
+    {
+        interval = interval_ ? interval_ : 1;
+        closed.clear();
+        count = 0;
+    }
+
+    void fill(Bucket &bucket) const
+    {
+        bucket.count = count;
+        bucket.mean = sum / count;
+        bucket.p5 = quantiles[0].get();
+        bucket.median = quantiles[1].get();
+        bucket.p95 = quantiles[2].get();
+    }
+
+    void close()
+    {
+        fill(open);
+        count = 0;
+
+        // Nobody takes them (database gone), drop the oldest
+        if (closed.size() >= MAX_CLOSED) closed.erase(closed.begin());
+        closed.push_back(open);
+    }
+};
+
+#endif // __STATS_H__
@@ -0,0 +1,259 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "stream.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+#include "web.h"
+#include "pipeline.h"
+
+#include <cstdio>
+#include <map>
+
+namespace stream {
+
+Format format = FORMAT_NONE;
+bool changedOnly = false;
+int flushInterval = 1000;
+
+namespace {
+
+constexpr size_t MAX_BUFFER_SIZE = 64 * 1024;
+
+StrBuf buffer;
+unsigned long long lastFlush = 0;
+bool metricsHeader = false;
+bool wlanHeader = false;
+
+std::map<const char *, size_t> lastCounts;
+std::map<std::string, std::string> lastClients;
+
+void addNum(const double val)
+{
+    // Avoid float noise such as 12.3999996 for integral values
+    if (val == (long long)val) buffer.format("%lld", (long long)val);
+    else buffer.format("%g", val);
+}
+
+void addJSONStr(const std::string &str)
+{
+    buffer += '"';
+
+    for (const char c : str)
+    {
+        switch (c)
+        {
+            case '"': buffer += "\\\""; break;
+            case '\\': buffer += "\\\\"; break;
+            case '\n': buffer += "\\n"; break;
+            case '\r': buffer += "\\r"; break;
+            case '\t': buffer += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) buffer.format("\\u%04x", c);
+                else buffer += c;
+        }
+    }
+
+    buffer += '"';
+}
+
+void addCSVStr(const std::string &str)
+{
+    if (str.find_first_of(",\"\r\n") == std::string::npos)
+    {
+        buffer += str;
+        return;
+    }
+
+    buffer += '"';
+
+    for (const char c : str)
+    {
+        if (c == '"') buffer += '"';
+        buffer += c;
+    }
+
+    buffer += '"';
+}
+
+void write(const unsigned long long time)
+{
+    if (buffer.length() >= MAX_BUFFER_SIZE || flushInterval <= 0 ||
+        time - lastFlush >= (unsigned long long)flushInterval)
+    {
+        flush();
+    }
+}
+
+} // anonymous namespace
+
+bool setFormat(const char *str)
+{
+    if (strEqual(str, "ndjson")) format = FORMAT_NDJSON;
+    else if (strEqual(str, "csv")) format = FORMAT_CSV;
+    else if (strEqual(str, "none")) format = FORMAT_NONE;
+    else
+    {
+        err.linef("Invalid output format: %s", str);
+        return false;
+    }
+
+    return true;
+}
+
+void record(const pipeline::Sample &sample)
+{
+    if (!isEnabled()) return;
+
+    const unsigned long long time = sample.time;
+    const size_t recordStart = buffer.length();
+    size_t numFields = 0;
+
+    if (format == FORMAT_NDJSON)
+    {
+        buffer.format("{\"time\":%llu", time);
+    }
+    else if (!metricsHeader)
+    {
+        buffer += "time,name,value\n";
+        metricsHeader = true;
+    }
+
+    for (uint16_t i = 0; i < sample.numValues; i++)
+    {
+        const pipeline::Sample::Value &value = sample.values[i];
+
+        size_t &lastCount = lastCounts[value.name];
+        const bool changed = lastCount != value.count;
+        lastCount = value.count;
+
+        if (changedOnly && !changed) continue;
+
+        if (format == FORMAT_NDJSON)
+        {
+            buffer.format(",\"%s\":", value.name);
+            addNum(value.val);
+        }
+        else
+        {
+            buffer.format("%llu,%s,", time, value.name);
+            addNum(value.val);
+            buffer += '\n';
+        }
+
+        numFields++;
+    }
+
+    if (format == FORMAT_NDJSON)
+    {
+        if (!numFields) buffer.resize(recordStart);
+        else buffer += "}\n";
+    }
+
+    for (uint16_t i = 0; i < sample.numEvents; i++)
+    {
+        const events::Event &event = sample.events[i];
+
+        if (format == FORMAT_NDJSON)
+        {
+            buffer.format("{\"time\":%llu,\"event\":\"%s\",\"before\":%llu,\"after\":%llu}\n",
+                          (unsigned long long)event.time, events::getTypeStr(event.type),
+                          event.before, event.after);
+        }
+        else
+        {
+            buffer.format("%llu,%s,%llu\n", (unsigned long long)event.time,
+                          events::getSeriesName(event.type), event.after);
+        }
+    }
+
+    write(time);
+}
+
+void recordWlanClients()
+{
+    if (!isEnabled()) return;
+
+    const unsigned long long time = getUnixMilliSeconds();
+
+    if (format == FORMAT_CSV && !wlanHeader)
+    {
+        buffer += "time,ssid,mac,ip,host,duration\n";
+        wlanHeader = true;
+    }
+
+    std::map<std::string, std::string> clients;
+
+    for (auto &it : web::wlan::ssids)
+    {
+        const std::string &ssid = it.first;
+
+        for (auto &client : *it.second.clients)
+        {
+            const std::string key = ssid + '\n' + client.macAddress;
+            const std::string val = client.ipAddress + '\n' + client.hostName;
+
+            const bool changed = !lastClients.count(key) || lastClients[key] != val;
+            clients[key] = val;
+
+            if (changedOnly && !changed) continue;
+
+            if (format == FORMAT_NDJSON)
+            {
+                buffer.format("{\"time\":%llu,\"ssid\":", time);
+                addJSONStr(ssid);
+                buffer += ",\"mac\":";
+                addJSONStr(client.macAddress);
+                buffer += ",\"ip\":";
+                addJSONStr(client.ipAddress);
+                buffer += ",\"host\":";
+                addJSONStr(client.hostName);
+                buffer.format(",\"duration\":%llu}\n", (unsigned long long)client.connectionDuration);
+            }
+            else
+            {
+                buffer.format("%llu,", time);
+                addCSVStr(ssid);
+                buffer += ',';
+                addCSVStr(client.macAddress);
+                buffer += ',';
+                addCSVStr(client.ipAddress);
+                buffer += ',';
+                addCSVStr(client.hostName);
+                buffer.format(",%llu\n", (unsigned long long)client.connectionDuration);
+            }
+        }
+    }
+
+    lastClients.swap(clients);
+
+    write(time);
+}
+
+void flush()
+{
+    lastFlush = getUnixMilliSeconds();
+
+    if (buffer.empty()) return;
+
+    fwrite(buffer.data(), 1, buffer.length(), stdout);
+    fflush(stdout);
+    buffer.clear();
+}
+
+} // namespace stream
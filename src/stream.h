@@ -0,0 +1,67 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+/*
+ * Machine readable output of the live views on stdout.
+ *
+ * NDJSON: one object per sample, {"time":<ms>,"<name>":<value>,...}
+ * CSV:    time,name,value (one row per value)
+ *
+ * Events: {"time":<ms>,"event":"<type>","before":<value>,"after":<value>}
+ * in NDJSON, time,event_<type>,<value after> in CSV.
+ *
+ * WLAN clients are written as one record per client:
+ * time, ssid, mac, ip, host, duration (seconds).
+ *
+ * Output is buffered and written every flushInterval milliseconds.
+ * Samples are written by the pipeline thread, WLAN clients by the
+ * polling thread, the live views never use both.
+ */
+
+namespace pipeline { struct Sample; }
+
+namespace stream {
+
+enum Format : int
+{
+    FORMAT_NONE,
+    FORMAT_NDJSON,
+    FORMAT_CSV
+};
+
+extern Format format;
+extern bool changedOnly;
+extern int flushInterval; // Milliseconds
+
+bool setFormat(const char *str);
+
+inline bool isEnabled()
+{
+    return format != FORMAT_NONE;
+}
+
+void record(const pipeline::Sample &sample); // Pipeline sink
+void recordWlanClients();
+void flush();
+
+} // namespace stream
+
+#endif // __STREAM_H__
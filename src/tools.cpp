@@ -401,6 +401,24 @@ void updateTime()
     now = getMilliSeconds();
 }
 
+TimeType getUnixMilliSeconds()
+{
+#ifdef _WIN32
+    // 100ns intervals since 1601-01-01
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    ULARGE_INTEGER t;
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    return (t.QuadPart - 116444736000000000ULL) / 10000;
+#else
+    struct timeval tv;
+    if (gettimeofday(&tv, nullptr) == 0)
+        return TimeType(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+    abort();
+#endif
+}
+
 static void initNanoClock()
 {
 #ifdef _WIN32
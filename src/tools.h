@@ -87,7 +87,7 @@ struct StrBuf : public std::string
     StrBuf &operator=(StrBuf&& strBuf);
 
     template <typename T>
-    void operator=(const T &s) { *this = s; }
+    void operator=(const T &s) { std::string::operator=(s); }
 };
 
 cxx14_constexpr bool strEqual(const char *str1, const char *str2)
@@ -212,6 +212,9 @@ inline TimeType getMilliSeconds() { return getMicroSeconds() / 1000; }
 extern TimeType now;
 void updateTime();
 
+// Wall clock, for anything that is written to disk
+TimeType getUnixMilliSeconds();
+
 const std::string &fmtMillis(TimeType millis, StrBuf &buf,
     const FmtMillisFlags flags = FMT_ALL);
 
@@ -0,0 +1,836 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#include "tslog.h"
+#include "huawei_tools.h"
+#include "cli_tools.h"
+#include "pipeline.h"
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tslog {
+
+char path[256] = "";
+int flushInterval = 60;
+
+namespace {
+
+constexpr char MAGIC[] = "HWTSLOG1";
+constexpr size_t MAGIC_LENGTH = sizeof(MAGIC) - 1;
+constexpr size_t MAX_BLOCK_SIZE = 512;
+constexpr size_t MAX_BLOCK_COUNT = 0xFFFF;
+constexpr size_t MAX_PENDING = 64 * 1024;
+
+// Serialization
+
+void putU8(std::string &out, const uint8_t val)
+{
+    out.push_back((char)val);
+}
+
+void putU16(std::string &out, const uint16_t val)
+{
+    putU8(out, val & 0xFF);
+    putU8(out, val >> 8);
+}
+
+void putU32(std::string &out, const uint32_t val)
+{
+    putU16(out, val & 0xFFFF);
+    putU16(out, val >> 16);
+}
+
+void putU64(std::string &out, const uint64_t val)
+{
+    putU32(out, val & 0xFFFFFFFF);
+    putU32(out, val >> 32);
+}
+
+uint64_t getU(const uint8_t *p, const int bytes)
+{
+    uint64_t val = 0;
+    for (int i = bytes - 1; i >= 0; i--) val = (val << 8) | p[i];
+    return val;
+}
+
+uint64_t doubleToBits(const double val)
+{
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    return bits;
+}
+
+double bitsToDouble(const uint64_t bits)
+{
+    double val;
+    memcpy(&val, &bits, sizeof(val));
+    return val;
+}
+
+// Bit streams, most significant bit first
+
+struct BitWriter
+{
+    std::string bytes;
+    int bitPos = 0; // Bits used in the last byte
+
+    void write(const uint64_t val, int n)
+    {
+        while (n > 0)
+        {
+            if (!bitPos) bytes.push_back(0);
+            const int free = 8 - bitPos;
+            const int take = n < free ? n : free;
+            const uint8_t bits = (val >> (n - take)) & ((1u << take) - 1);
+            bytes.back() |= bits << (free - take);
+            bitPos = (bitPos + take) & 7;
+            n -= take;
+        }
+    }
+
+    void clear()
+    {
+        bytes.clear();
+        bitPos = 0;
+    }
+};
+
+struct BitReader
+{
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0; // In bits
+
+    bool read(uint64_t &val, int n)
+    {
+        if (pos + n > size * 8) return false;
+
+        val = 0;
+
+        while (n > 0)
+        {
+            const int bitPos = pos & 7;
+            const int avail = 8 - bitPos;
+            const int take = n < avail ? n : avail;
+            const uint8_t byte = data[pos >> 3];
+            val = (val << take) | ((byte >> (avail - take)) & ((1u << take) - 1));
+            pos += take;
+            n -= take;
+        }
+
+        return true;
+    }
+
+    BitReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+};
+
+// Delta-of-delta buckets: {prefix, prefix bits, value bits}
+
+constexpr struct
+{
+    uint64_t prefix;
+    int prefixBits;
+    int valueBits;
+} dodBuckets[] =
+{
+    {0x2, 2, 7},
+    {0x6, 3, 9},
+    {0xE, 4, 12}
+};
+
+// Writer
+
+struct Series
+{
+    uint16_t id;
+    size_t lastCount = 0;
+
+    BitWriter block;
+    uint16_t count = 0;
+    TimeType prevTime;
+    int64_t prevDelta;
+    uint64_t prevBits;
+    int prevLeading;
+    int prevTrailing;
+
+    void append(const TimeType time, const double val);
+    void flush(std::string &out);
+};
+
+FILE *file = nullptr;
+std::map<const char *, Series> series;
+uint16_t nextId = 0;
+TimeType lastFlush = 0;
+
+std::string pending;
+std::mutex mutex;
+std::condition_variable cond;
+std::thread writer;
+bool stop = false;
+bool wakeup = false;
+XMLNumType lastBand = 0;
+XMLNumType lastCell = 0;
+
+Series *getSeries(const char *name)
+{
+    auto it = series.find(name);
+    if (it != series.end()) return &it->second;
+
+    if (nextId == 0xFFFF) return nullptr;
+
+    Series &s = series[name];
+    s.id = nextId++;
+
+    const size_t nameLength = std::min<size_t>(strlen(name), 255);
+    putU8(pending, 'N');
+    putU16(pending, s.id);
+    putU8(pending, nameLength);
+    pending.append(name, nameLength);
+
+    return &s;
+}
+
+void Series::append(const TimeType time, const double val)
+{
+    const uint64_t bits = doubleToBits(val);
+
+    if (!count)
+    {
+        block.write(time, 64);
+        block.write(bits, 64);
+        prevDelta = 0;
+        prevLeading = -1;
+    }
+    else
+    {
+        const int64_t delta = (int64_t)(time - prevTime);
+        const int64_t dod = delta - prevDelta;
+
+        if (!dod)
+        {
+            block.write(0, 1);
+        }
+        else
+        {
+            bool written = false;
+
+            for (auto &bucket : dodBuckets)
+            {
+                const int64_t range = 1LL << (bucket.valueBits - 1);
+                if (dod < -(range - 1) || dod > range) continue;
+
+                block.write(bucket.prefix, bucket.prefixBits);
+                block.write(dod + (range - 1), bucket.valueBits);
+                written = true;
+                break;
+            }
+
+            if (!written)
+            {
+                block.write(0xF, 4);
+                block.write((uint64_t)dod, 64);
+            }
+        }
+
+        prevDelta = delta;
+
+        const uint64_t x = bits ^ prevBits;
+
+        if (!x)
+        {
+            block.write(0, 1);
+        }
+        else
+        {
+            int leading = __builtin_clzll(x);
+            const int trailing = __builtin_ctzll(x);
+            if (leading > 31) leading = 31;
+
+            if (prevLeading != -1 && leading >= prevLeading && trailing >= prevTrailing)
+            {
+                block.write(0x2, 2);
+                block.write(x >> prevTrailing, 64 - prevLeading - prevTrailing);
+            }
+            else
+            {
+                const int significant = 64 - leading - trailing;
+                block.write(0x3, 2);
+                block.write(leading, 5);
+                block.write(significant & 63, 6); // 64 is stored as 0
+                block.write(x >> trailing, significant);
+                prevLeading = leading;
+                prevTrailing = trailing;
+            }
+        }
+    }
+
+    prevTime = time;
+    prevBits = bits;
+    count++;
+}
+
+void Series::flush(std::string &out)
+{
+    if (!count) return;
+
+    putU8(out, 'B');
+    putU16(out, id);
+    putU16(out, count);
+    putU32(out, block.bytes.size());
+    out += block.bytes;
+
+    block.clear();
+    count = 0;
+}
+
+void writerThread()
+{
+    std::string buf;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, []{ return stop || wakeup; });
+            wakeup = false;
+            buf.swap(pending);
+        }
+
+        if (!buf.empty())
+        {
+            if (fwrite(buf.data(), 1, buf.size(), file) != buf.size())
+                errfunf_once("Writing %s failed", path);
+
+            fflush(file);
+#ifdef _WIN32
+            _commit(_fileno(file));
+#else
+            fsync(fileno(file));
+#endif
+            buf.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stop && pending.empty()) break;
+    }
+}
+
+void notifyWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        wakeup = true;
+    }
+    cond.notify_one();
+}
+
+// Offset after the last complete record, 0 if the file has a record
+// of unknown type. Records cut off by a crash or power loss have to go
+// before appending, the reader stops at the first incomplete one.
+
+long findEnd(FILE *f, const long fileSize)
+{
+    long pos = MAGIC_LENGTH;
+    uint8_t header[1 + 8];
+
+    for (;;)
+    {
+        if (fseek(f, pos, SEEK_SET) || fread(header, 1, 1, f) != 1) return pos;
+
+        size_t headerLength;
+
+        switch (header[0])
+        {
+            case 'S': headerLength = 8; break;
+            case 'N': headerLength = 3; break;
+            case 'B': headerLength = 8; break;
+            default: return 0;
+        }
+
+        if (fread(header + 1, 1, headerLength, f) != headerLength) return pos;
+
+        long length = 1 + headerLength;
+        if (header[0] == 'N') length += header[3];
+        if (header[0] == 'B') length += getU(header + 5, 4);
+
+        if (length > fileSize - pos) return pos;
+        pos += length;
+    }
+}
+
+bool truncateFile(FILE *f, const long length)
+{
+#ifdef _WIN32
+    return !_chsize_s(_fileno(f), length);
+#else
+    return !ftruncate(fileno(f), length);
+#endif
+}
+
+} // anonymous namespace
+
+bool open(const char *path_)
+{
+    if (file) close();
+
+    file = fopen(path_, "ab+");
+
+    if (!file)
+    {
+        err.linef("Could not open %s", path_);
+        return false;
+    }
+
+    std::string header;
+    fseek(file, 0, SEEK_END);
+
+    const long fileSize = ftell(file);
+
+    if (fileSize == 0)
+    {
+        header.append(MAGIC, MAGIC_LENGTH);
+    }
+    else
+    {
+        char magic[MAGIC_LENGTH];
+        fseek(file, 0, SEEK_SET);
+
+        if (fread(magic, 1, MAGIC_LENGTH, file) != MAGIC_LENGTH ||
+            memcmp(magic, MAGIC, MAGIC_LENGTH))
+        {
+            err.linef("%s is not a signal log", path_);
+            fclose(file);
+            file = nullptr;
+            return false;
+        }
+
+        const long end = findEnd(file, fileSize);
+
+        if (!end)
+        {
+            // Appending would leave the new sessions unreadable
+            err.linef("%s has a corrupt record, not appending to it", path_);
+            fclose(file);
+            file = nullptr;
+            return false;
+        }
+
+        if (end != fileSize)
+        {
+            warn.linef("%s ends with an incomplete record, dropping its %ld bytes",
+                       path_, fileSize - end);
+
+            if (!truncateFile(file, end))
+            {
+                err.linef("Could not truncate %s", path_);
+                fclose(file);
+                file = nullptr;
+                return false;
+            }
+        }
+
+        // Switching from reading to appending
+        fseek(file, 0, SEEK_END);
+    }
+
+    copystr(path, path_);
+    putU8(header, 'S');
+    putU64(header, getUnixMilliSeconds());
+
+    pending = std::move(header);
+    series.clear();
+    nextId = 0;
+    lastBand = lastCell = 0;
+    stop = false;
+    wakeup = false;
+
+    lastFlush = getUnixMilliSeconds();
+
+    writer = std::thread(writerThread);
+
+    return true;
+}
+
+bool isOpen()
+{
+    return file != nullptr;
+}
+
+void record(const pipeline::Sample &sample)
+{
+    if (!file) return;
+
+    // Runs on the pipeline thread, the global clock belongs to the poller
+    const TimeType time = sample.time;
+    const bool flushAll = time - lastFlush >= (TimeType)flushInterval * oneSecond;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto append = [&](Series &s, const TimeType time, const double val)
+    {
+        s.append(time, val);
+
+        if (s.block.bytes.size() >= MAX_BLOCK_SIZE || s.count == MAX_BLOCK_COUNT)
+            s.flush(pending);
+    };
+
+    for (uint16_t i = 0; i < sample.numValues; i++)
+    {
+        const pipeline::Sample::Value &value = sample.values[i];
+
+        Series *s = getSeries(value.name);
+        if (!s) continue;
+
+        // SignalValue::update() only counts changed values
+        if (s->lastCount == value.count) continue;
+        s->lastCount = value.count;
+
+        append(*s, time, value.val);
+    }
+
+    // Events are recorded as the value after the change,
+    // the value before is the previous sample of the series.
+
+    for (uint16_t i = 0; i < sample.numEvents; i++)
+    {
+        const events::Event &event = sample.events[i];
+        Series *s = getSeries(events::getSeriesName(event.type));
+        if (s) append(*s, event.time, event.after);
+    }
+
+    // Serving band and cell, offline queries filter on them
+
+    auto appendRadioValue = [&](const char *name, const XMLNumType val, XMLNumType &last)
+    {
+        if (!val || val == __XML_NUM_ERROR__ || val == last) return;
+        last = val;
+
+        Series *s = getSeries(name);
+        if (s) append(*s, time, val);
+    };
+
+    appendRadioValue("band", sample.band, lastBand);
+    appendRadioValue("cell", sample.cell, lastCell);
+
+    if (flushAll)
+    {
+        for (auto &it : series) it.second.flush(pending);
+        lastFlush = time;
+    }
+
+    if (flushAll || pending.size() >= MAX_PENDING)
+    {
+        wakeup = true;
+        cond.notify_one();
+    }
+}
+
+void close()
+{
+    if (!file) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &it : series) it.second.flush(pending);
+        stop = true;
+    }
+
+    notifyWriter();
+    writer.join();
+
+    fclose(file);
+    file = nullptr;
+    series.clear();
+}
+
+// Reader
+
+bool Reader::open(const char *path)
+{
+    close();
+
+#ifdef _WIN32
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = new uint8_t[size ? size : 1];
+    if (fread(buf, 1, size, f) != size) size = 0;
+    fclose(f);
+    data = buf;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) == -1 || !st.st_size)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        size = 0;
+        return false;
+    }
+
+    data = (const uint8_t*)map;
+    mapped = true;
+#endif
+
+    if (!parse())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void Reader::close()
+{
+    if (!data) return;
+
+#ifdef _WIN32
+    delete[] data;
+#else
+    if (mapped) munmap((void*)data, size);
+#endif
+
+    data = nullptr;
+    size = 0;
+    mapped = false;
+    names.clear();
+    blocks.clear();
+}
+
+bool Reader::parse()
+{
+    if (size < MAGIC_LENGTH || memcmp(data, MAGIC, MAGIC_LENGTH)) return false;
+
+    std::vector<const std::string*> ids;
+    size_t pos = MAGIC_LENGTH;
+    uint32_t session = 0;
+
+    auto have = [&](size_t n) { return pos + n <= size; };
+
+    // A truncated record at the end is not an error,
+    // the process may have died while appending.
+
+    while (have(1))
+    {
+        const uint8_t type = data[pos++];
+
+        switch (type)
+        {
+            case 'S':
+            {
+                if (!have(8)) return true;
+                pos += 8;
+                ids.clear();
+                if (!blocks.empty()) session++;
+                break;
+            }
+            case 'N':
+            {
+                if (!have(3)) return true;
+                const uint16_t id = getU(data + pos, 2);
+                const uint8_t length = data[pos + 2];
+                pos += 3;
+                if (!have(length)) return true;
+                names.emplace_back((const char*)data + pos, length);
+                pos += length;
+                if (ids.size() <= id) ids.resize(id + 1);
+                ids[id] = &names.back();
+                break;
+            }
+            case 'B':
+            {
+                if (!have(8)) return true;
+                Block block;
+                const uint16_t id = getU(data + pos, 2);
+                block.count = getU(data + pos + 2, 2);
+                block.size = getU(data + pos + 4, 4);
+                pos += 8;
+                if (!have(block.size)) return true;
+                block.data = data + pos;
+                pos += block.size;
+                if (id >= ids.size() || !ids[id])
+                {
+                    dbg.linef("Block references unknown series %u", (unsigned)id);
+                    break;
+                }
+                block.name = ids[id];
+                block.session = session;
+                blocks.push_back(block);
+                break;
+            }
+            default:
+            {
+                err.linef("Corrupt record at offset %zu", pos - 1);
+                return !blocks.empty();
+            }
+        }
+    }
+
+    return true;
+}
+
+size_t Reader::decode(const Block &block, TimeType *times, double *vals)
+{
+    BitReader in(block.data, block.size);
+    uint64_t time, bits, v;
+    int64_t delta = 0;
+    int leading = 0;
+    int trailing = 0;
+    size_t n = 0;
+
+    if (!block.count) return 0;
+    if (!in.read(time, 64) || !in.read(bits, 64)) return 0;
+
+    times[n] = time;
+    vals[n++] = bitsToDouble(bits);
+
+    while (n < block.count)
+    {
+        // Timestamp
+
+        if (!in.read(v, 1)) break;
+
+        if (v)
+        {
+            bool decoded = false;
+            uint64_t prefix = 1;
+            int prefixBits = 1;
+
+            for (auto &bucket : dodBuckets)
+            {
+                if (!in.read(v, 1)) return n;
+                prefix = (prefix << 1) | v;
+                prefixBits++;
+
+                if (prefix == bucket.prefix && prefixBits == bucket.prefixBits)
+                {
+                    const int64_t range = 1LL << (bucket.valueBits - 1);
+                    if (!in.read(v, bucket.valueBits)) return n;
+                    delta += (int64_t)v - (range - 1);
+                    decoded = true;
+                    break;
+                }
+            }
+
+            if (!decoded)
+            {
+                if (!in.read(v, 64)) return n;
+                delta += (int64_t)v;
+            }
+        }
+
+        time += delta;
+
+        // Value
+
+        if (!in.read(v, 1)) break;
+
+        if (v)
+        {
+            if (!in.read(v, 1)) break;
+
+            if (v)
+            {
+                uint64_t l, s;
+                if (!in.read(l, 5) || !in.read(s, 6)) break;
+                leading = l;
+                const int significant = s ? s : 64;
+                trailing = 64 - leading - significant;
+            }
+
+            if (!in.read(v, 64 - leading - trailing)) break;
+            bits ^= v << trailing;
+        }
+
+        times[n] = time;
+        vals[n++] = bitsToDouble(bits);
+    }
+
+    return n;
+}
+
+TimeType Reader::getFirstTime(const Block &block)
+{
+    BitReader in(block.data, block.size);
+    uint64_t time;
+
+    if (!block.count || !in.read(time, 64)) return 0;
+    return time;
+}
+
+namespace cli {
+using namespace ::cli;
+
+bool dump(const char *path)
+{
+    Reader reader;
+
+    if (!reader.open(path))
+    {
+        err.linef("Could not read %s", path);
+        return false;
+    }
+
+    std::vector<TimeType> times;
+    std::vector<double> vals;
+
+    outf("time,name,value\n");
+
+    for (auto &block : reader.getBlocks())
+    {
+        times.resize(block.count);
+        vals.resize(block.count);
+
+        const size_t n = Reader::decode(block, times.data(), vals.data());
+
+        for (size_t i = 0; i < n; i++)
+            outf("%llu,%s,%g\n", times[i], block.name->c_str(), vals[i]);
+    }
+
+    return true;
+}
+
+} // namespace cli
+
+} // namespace tslog
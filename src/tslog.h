@@ -0,0 +1,97 @@
+/***************************************************************************
+ *  Huawei Tool                                                            *
+ *  Copyright (c) 2017-2020 unknown (unknown.lteforum@gmail.com)           *
+ *                                                                         *
+ *  This program is free software: you can redistribute it and/or modify   *
+ *  it under the terms of the GNU General Public License as published by   *
+ *  the Free Software Foundation, either version 3 of the License, or      *
+ *  (at your option) any later version.                                    *
+ *                                                                         *
+ *  This program is distributed in the hope that it will be useful,        *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *  GNU General Public License for more details.                           *
+ *                                                                         *
+ *  You should have received a copy of the GNU General Public License      *
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.  *
+ **************************************************************************/
+
+#ifndef __TSLOG_H__
+#define __TSLOG_H__
+
+#include "tools.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+/*
+ * Append-only time series log.
+ *
+ * File layout: "HWTSLOG1" followed by records.
+ *
+ *   'S' u64 start time                 Session start, resets the series ids
+ *   'N' u16 id, u8 length, name        Series definition
+ *   'B' u16 id, u16 count, u32 size    Block of compressed samples
+ *
+ * Blocks are Gorilla compressed: delta-of-delta timestamps and
+ * XOR'ed values. Only changed values are recorded.
+ */
+
+namespace pipeline { struct Sample; }
+
+namespace tslog {
+
+extern char path[256];
+extern int flushInterval; // Seconds
+
+bool open(const char *path);
+bool isOpen();
+void record(const pipeline::Sample &sample); // Pipeline sink
+void close();
+
+class Reader
+{
+public:
+    struct Block
+    {
+        const std::string *name;
+        const uint8_t *data;
+        uint32_t size;
+        uint16_t count;
+        uint32_t session; // Index of the session the block belongs to
+    };
+
+    bool open(const char *path);
+    void close();
+
+    const std::vector<Block> &getBlocks() const { return blocks; }
+
+    // Returns the number of decoded samples,
+    // times and vals must have room for block.count.
+    static size_t decode(const Block &block, TimeType *times, double *vals);
+    static TimeType getFirstTime(const Block &block);
+
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader &operator=(const Reader&) = delete;
+    ~Reader() { close(); }
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::deque<std::string> names;
+    std::vector<Block> blocks;
+
+    bool parse();
+};
+
+namespace cli {
+bool dump(const char *path);
+} // namespace cli
+
+} // namespace tslog
+
+#endif // __TSLOG_H__
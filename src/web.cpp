@@ -18,9 +18,18 @@
 
 #include "web.h"
 #include "cli_tools.h"
+#include "pipeline.h"
+#include "db.h"
+#include "exporter.h"
+#include "stream.h"
+#include "events.h"
+#include "hybrid.h"
+#include "at_tcp.h"
 
 #include <map>
 #include <vector>
+#include <algorithm>
+#include <ctime>
 
 #include <curl/curl.h>
 #include <rapidxml.hpp>
@@ -747,10 +756,196 @@ bool updateClients()
 
 } // namespace wlan
 
+namespace {
+
+// Values currently supplied by AT URCs are skipped in hybrid mode
+
+template<typename T>
+void updateRadioValue(SignalValue<> &value, const T &val, const bool merged)
+{
+    if (merged && hybrid::isOwnedByAT(value)) return;
+    value.update(val);
+}
+
+void updateRadioValues(RadioValues &values, rapidxml::xml_node<> *response,
+                       const bool merged = false)
+{
+    updateRadioValue(values.RSCP, getXMLNum(response, "rscp"), merged);
+    updateRadioValue(values.ECIO, getXMLStr(response, "ecio"), merged);
+    updateRadioValue(values.RSRP, getXMLStr(response, "rsrp"), merged);
+    updateRadioValue(values.RSRQ, getXMLStr(response, "rsrq"), merged);
+    updateRadioValue(values.RSSI, getXMLStr(response, "rssi"), merged);
+    updateRadioValue(values.SINR, getXMLStr(response, "sinr"), merged);
+
+    updateRadioValue(values.CQI[0], getXMLStr(response, "cqi0"), merged);
+    updateRadioValue(values.CQI[1], getXMLStr(response, "cqi1"), merged);
+
+    values.DLMCS[0].update(getXMLSubValStr(response, "dl_mcs", "mcsDownCarrier1Code0:"));
+    values.DLMCS[1].update(getXMLSubValStr(response, "dl_mcs", "mcsDownCarrier1Code1:"));
+    values.UPMCS.update(getXMLSubValStr(response, "ul_mcs", "mcsUpCarrier1:"));
+
+    values.TXPWrPPUSCH.update(getXMLSubValStr(response, "txpower", "PPusch:"));
+    values.TXPWrPPUCCH.update(getXMLSubValStr(response, "txpower", "PPucch:"));
+    values.TXPWrPSRS.update(getXMLSubValStr(response, "txpower", "PSrs:"));
+    values.TXPWrPPRACH.update(getXMLSubValStr(response, "txpower", "PPrach:"));
+}
+
+} // anonymous namespace
+
+bool updateSignal()
+{
+    // Avoid name clash with ::signal
+    using x::signal;
+
+    HttpResult httpResult;
+    HttpOpts httpOpts;
+#warning lower
+    // /api/net/current-plmn
+
+    // Requested first so that PLMN, mode, band and cell
+    // of the per-cell statistics all belong to this sample.
+
+    auto *response = xmlHttpRequest(
+        "Getting PLMN",
+        "/api/net/current-plmn",
+        httpResult,
+        httpOpts
+    );
+
+    if (!response) return false;
+
+    signal.operatorName = getXMLStr(response, "FullName");
+    signal.operatorNameShort = getXMLStr(response, "ShortName");
+    signal.PLMN = getXMLNum(response, "Numeric");
+
+    httpResult.reset();
+    httpOpts.reset();
+
+    // /api/monitoring/status
+
+    response = xmlHttpRequest(
+        "Getting Network Type",
+        "/api/monitoring/status",
+        httpResult,
+        httpOpts
+    );
+
+    if (!response) return false;
+
+    signal.networkTypeEx = getXMLNum(response, "CurrentNetworkTypeEx");
+
+    // 901: Connected, 900: Connecting, 902: Disconnected, 903: Disconnecting
+    const XMLNumType connectionStatus = getXMLNum(response, "ConnectionStatus");
+    if (connectionStatus != __XML_NUM_ERROR__) signal.connStatus.update(connectionStatus != 901, now);
+
+    httpResult.reset();
+    httpOpts.reset();
+
+    // /api/device/signal
+
+    response = xmlHttpRequest(
+        "Getting Signal Strength",
+        "/api/device/signal",
+        httpResult,
+        httpOpts
+    );
+
+    if (!response) return false;
+
+    signal.band = getXMLNum(response, "band");
+    signal.cell = getXMLNum(response, "cell_id");
+    signal.DLBW = getXMLNum(response, "dlbandwidth");
+    signal.UPBW = getXMLNum(response, "ulbandwidth");
+    signal.mode = getXMLNum(response, "mode");
+
+    updateRadioValues(signal, response, hybrid::enabled);
+    const CellKey cellKey = {signal.PLMN, signal.mode, signal.band, signal.cell};
+    if (cellKey.isValid()) updateRadioValues(cells::select(cellKey), response);
+
+    events::detect();
+
+    return true;
+}
+
+namespace {
+
+bool getTrafficStats(TrafficStats &traffic, const char *desc, HttpResult &httpResult,
+                     HttpOpts &httpOpts, bool cached = false)
+{
+    rapidxml::xml_node<> *response;
+
+    if (!cached)
+    {
+        std::string request = "/api/monitoring/";
+
+        if (!strcmp(desc, "CurrentMonth")) request += "month_statistics";
+        else request += "traffic-statistics";
+
+        httpResult.reset();
+        httpOpts.reset();
+
+        response = xmlHttpRequest(
+            "Getting Traffic Stats",
+            request.c_str(),
+            httpResult,
+            httpOpts
+        );
+
+        if (!response) return false;
+    }
+    else
+    {
+        response = httpResult.xml.first_node("response");
+    }
+
+    if (response->first_node("showtraffic"))
+    {
+        unsigned long long showTraffic = getXMLNum(response, "showtraffic");
+        if (showTraffic == __XML_NUM_ERROR__) return false;
+
+        if (showTraffic == 0)
+        {
+            errfunf("showtraffic is set to '0'");
+            return false;
+        }
+    }
+
+    std::string connectTime = std::string(desc) + "ConnectTime";
+    std::string currentDownload = std::string(desc) + "Download";
+    std::string currentUpload = std::string(desc) + "Upload";
+
+    if (!strcmp(desc, "CurrentMonth")) connectTime = "MonthDuration";
+
+    updateTime();
+
+    traffic.CD.update(getXMLNum(response, connectTime.c_str()));
+    traffic.DL.update(getXMLNum(response, currentDownload.c_str()));
+    traffic.UP.update(getXMLNum(response, currentUpload.c_str()));
+
+    return traffic.isSet();
+}
+
+} // anonymous namespace
+
+bool updateTraffic()
+{
+    HttpResult httpResult;
+    HttpOpts httpOpts;
+
+    if (!getTrafficStats(traffic.current, "Current", httpResult, httpOpts)) return false;
+    if (!getTrafficStats(traffic.total, "Total", httpResult, httpOpts, true)) return false;
+    if (!getTrafficStats(traffic.monthly, "CurrentMonth", httpResult, httpOpts)) return false;
+
+    return true;
+}
+
 namespace cli {
 using namespace ::cli;
 
 int trafficColumnSpacing = 40;
+char signalStrengthColumns[64] = "Current, Average, Min, Max";
+int signalStrengthColumnSpacing = 30;
+bool signalStrengthCellTable = true;
 
 bool showAntennaType()
 {
@@ -1157,99 +1352,172 @@ bool showSignalStrength()
         return str.getLines();
     };
 
-    auto printSignalStats = [&]()
+    std::vector<std::pair<std::string, SignalValue<>::GetType>> wantedColumns;
+    std::vector<std::string> columnNames;
+
+    if (!splitStr(columnNames, signalStrengthColumns, ", ", false))
     {
-    #warning conf (parameter too)
-        std::vector<status::Column> columns;
+        errfunf("Empty columns");
+        return false;
+    }
 
-        columns.push_back({"Current", formatSignalStats(SignalValue<>::GET_CURRENT)});
-        columns.push_back({"Average", formatSignalStats(SignalValue<>::GET_AVERAGE)});
-        columns.push_back({"Min", formatSignalStats(SignalValue<>::GET_MIN)});
-        columns.push_back({"Max", formatSignalStats(SignalValue<>::GET_MAX)});
+    for (auto &column : columnNames)
+    {
+        SignalValue<>::GetType type = SignalValue<>::getGetTypeByStr(column.c_str());
 
-        status::addColumns(columns, 30);
-        status::show();
-    };
+        if (type == SignalValue<>::GET_INVALID)
+        {
+            errfunf("Invalid column: %s", column.c_str());
+            return false;
+        }
 
-    do
+        wantedColumns.push_back({std::move(column), type});
+    }
+
+    auto formatCellTable = [&]()
     {
-        web::HttpResult httpResult;
-        web::HttpOpts httpOpts;
+        // Most recently seen cells first, '*' marks the serving cell
 
-        // /api/device/signal
+        constexpr size_t MAX_CELLS = 10;
 
-        auto *response = web::xmlHttpRequest(
-            "Getting Signal Strength",
-            "/api/device/signal",
-            httpResult,
-            httpOpts
-        );
+        std::vector<std::pair<const CellKey *, const CellStats *>> sortedCells;
 
-        if (!response) return false;
+        for (auto &it : cells::index)
+            sortedCells.push_back({&it.first, &it.second});
 
-        signal.RSCP.update(getXMLNum(response, "rscp"));
-        signal.ECIO.update(getXMLStr(response, "ecio"));
-        signal.RSRP.update(getXMLStr(response, "rsrp"));
-        signal.RSRQ.update(getXMLStr(response, "rsrq"));
-        signal.RSSI.update(getXMLStr(response, "rssi"));
-        signal.SINR.update(getXMLStr(response, "sinr"));
+        std::sort(sortedCells.begin(), sortedCells.end(), [](
+            const std::pair<const CellKey *, const CellStats *> &a,
+            const std::pair<const CellKey *, const CellStats *> &b)
+        {
+            return a.second->lastSeen > b.second->lastSeen;
+        });
 
-        signal.CQI[0].update(getXMLStr(response, "cqi0"));
-        signal.CQI[1].update(getXMLStr(response, "cqi1"));
+        if (sortedCells.size() > MAX_CELLS) sortedCells.resize(MAX_CELLS);
 
-        signal.DLMCS[0].update(getXMLSubValStr(response, "dl_mcs", "mcsDownCarrier1Code0:"));
-        signal.DLMCS[1].update(getXMLSubValStr(response, "dl_mcs", "mcsDownCarrier1Code1:"));
-        signal.UPMCS.update(getXMLSubValStr(response, "ul_mcs", "mcsUpCarrier1:"));
+        StrBuf seen;
 
-        signal.TXPWrPPUSCH.update(getXMLSubValStr(response, "txpower", "PPusch:"));
-        signal.TXPWrPPUCCH.update(getXMLSubValStr(response, "txpower", "PPucch:"));
-        signal.TXPWrPSRS.update(getXMLSubValStr(response, "txpower", "PSrs:"));
-        signal.TXPWrPPRACH.update(getXMLSubValStr(response, "txpower", "PPrach:"));
+        status::addChar('-', 80);
+        status::format("\n  %-7s %-5s %-4s %-9s %-6s %-19s %-5s %-5s %s\n\n",
+                       "PLMN", "MODE", "BAND", "CELL", "VISITS",
+                       "RSRP|RSCP (MIN/MAX)", "RSRQ", "SINR", "SEEN");
 
-        signal.band = getXMLNum(response, "band");
-        signal.cell = getXMLNum(response, "cell_id");
-        signal.DLBW = getXMLNum(response, "dlbandwidth");
-        signal.UPBW = getXMLNum(response, "ulbandwidth");
-        signal.mode = getXMLNum(response, "mode");
+        for (auto &it : sortedCells)
+        {
+            const CellKey &key = *it.first;
+            const CellStats &stats = *it.second;
+            const bool lte = key.mode == 7;
+            const SignalValue<> &level = lte ? stats.RSRP : stats.RSCP;
+            const SignalValue<> &quality = lte ? stats.RSRQ : stats.ECIO;
+
+            seen.clear();
+            if (&stats == cells::getActive()) seen += "now";
+            else seen.fmtMillis(getElapsedTime(stats.lastSeen));
+
+            StrBuf levelStr;
+            levelStr.format("%d (%d/%d)", level.getVal(SignalValue<>::GET_AVERAGE),
+                            level.getVal(SignalValue<>::GET_MIN),
+                            level.getVal(SignalValue<>::GET_MAX));
+
+            status::format("%c %-7llu %-5s %-4llu %-9llX %-6zu %-19s %-5d %-5s %s\n",
+                           &stats == cells::getActive() ? '*' : ' ',
+                           key.PLMN, lte ? "LTE" : key.mode == 2 ? "WCDMA" : "GSM",
+                           key.band, key.cell, stats.visits, levelStr.c_str(),
+                           quality.getVal(SignalValue<>::GET_AVERAGE),
+                           lte ? std::to_string(stats.SINR.getVal(SignalValue<>::GET_AVERAGE)).c_str() : "-",
+                           seen.c_str());
+        }
+    };
 
-        httpResult.reset();
-        httpOpts.reset();
+    auto formatEvents = [&]()
+    {
+        constexpr size_t MAX_EVENTS = 5;
 
-        // /api/monitoring/status
+        const std::deque<events::Event> &recent = events::getRecent();
+        const size_t first = recent.size() > MAX_EVENTS ? recent.size() - MAX_EVENTS : 0;
 
-        response = web::xmlHttpRequest(
-            "Getting Network Type",
-            "/api/monitoring/status",
-            httpResult,
-            httpOpts
-        );
+        status::addChar('-', 80);
+        status::append("\n  EVENTS\n\n");
 
-        if (!response) return false;
+        for (size_t i = recent.size(); i-- > first;)
+        {
+            const events::Event &event = recent[i];
+            const time_t time = event.time / oneSecond;
+            char timeStr[32];
 
-        signal.networkTypeEx = getXMLNum(response, "CurrentNetworkTypeEx");
+            strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", localtime(&time));
 
-        httpResult.reset();
-        httpOpts.reset();
-#warning lower
-        // /api/net/current-plmn
+            switch (event.type)
+            {
+                case events::CELL:
+                    status::format("  %s  cell          %llX -> %llX\n", timeStr, event.before, event.after);
+                    break;
+                case events::CONNECTION:
+                    status::format("  %s  connection    %s\n", timeStr, event.after ? "up" : "down");
+                    break;
+                default:
+                    status::format("  %s  %-12s  %llu -> %llu\n", timeStr,
+                                   events::getTypeStr(event.type), event.before, event.after);
+            }
+        }
+    };
 
-        response = web::xmlHttpRequest(
-            "Getting PLMN",
-            "/api/net/current-plmn",
-            httpResult,
-            httpOpts
-        );
+    auto printSignalStats = [&]()
+    {
+        if (stream::isEnabled()) return;
 
-        if (!response) return false;
+        std::vector<status::Column> columns;
+
+        for (auto &column : wantedColumns)
+            columns.push_back({column.first, formatSignalStats(column.second)});
+
+        status::addColumns(columns, signalStrengthColumnSpacing);
+
+        if (hybrid::enabled)
+        {
+            StrBuf sources;
+            hybrid::formatSources(sources);
+            status::append(sources.c_str(), sources.length());
+            status::addChar('\n');
+        }
+
+        if (signalStrengthCellTable && !cells::index.empty()) formatCellTable();
+        if (!events::getRecent().empty()) formatEvents();
+        status::show();
+    };
+
+    if (hybrid::enabled)
+    {
+        // AT samples are merged below and published together
+        at_tcp::publishSamples = false;
+    }
+
+    do
+    {
+        bool updated = false;
 
-        signal.operatorName = getXMLStr(response, "FullName");
-        signal.operatorNameShort = getXMLStr(response, "ShortName");
-        signal.PLMN = getXMLNum(response, "Numeric");
+        if (!hybrid::enabled || hybrid::isWebDue())
+        {
+            if (!updateSignal()) return false;
+            if (hybrid::enabled) hybrid::webUpdated();
+            updated = true;
+        }
+
+        if (hybrid::enabled)
+        {
+            // Waits for URCs, or until the next web poll
+            if (!at_tcp::process(50)) return false;
+            if (hybrid::mergeAT()) updated = true;
+        }
+
+        if (updated)
+        {
+            pipeline::onSample();
+        }
 
         disableDebugLog("Signal Strength Loop: ");
 
         printSignalStats();
-        while (requestLimiter.limit()) printSignalStats();
+        if (!hybrid::enabled) while (requestLimiter.limit()) printSignalStats();
     } while (!checkExit());
 
     enableDebugLog();
@@ -1266,6 +1534,8 @@ bool showWlanClients()
 
     auto printWlanClients = [&]()
     {
+        if (stream::isEnabled()) return;
+
         if (wlan::ssids.empty())
         {
             status::append("No clients connected!");
@@ -1320,6 +1590,9 @@ bool showWlanClients()
     do
     {
         if (!wlan::updateClients()) return false;
+        db::recordWlanClients();
+        exporter::update();
+        stream::recordWlanClients();
         disableDebugLog("WLAN Clients Loop: ");
         printWlanClients();
         while (requestLimiter.limit() && !checkExit()) printWlanClients();
@@ -1335,15 +1608,14 @@ bool showTraffic()
 {
     RequestLimiter<1, 2000> requestLimiter;
 
-    TrafficStats currentTraffic("Current");
-    TrafficStats totalTraffic("Total");
-    TrafficStats monthlyTraffic("Monthly");
-
-    web::HttpResult httpResult;
-    web::HttpOpts httpOpts;
+    TrafficStats &currentTraffic = traffic.current;
+    TrafficStats &totalTraffic = traffic.total;
+    TrafficStats &monthlyTraffic = traffic.monthly;
 
     auto printTrafficStats = [&]()
     {
+        if (stream::isEnabled()) return;
+
         auto formaTrafficStats = [&](const TrafficStats &traffic)
         {
             updateTime();
@@ -1380,6 +1652,9 @@ bool showTraffic()
             str.format("Speed DL:  %.3f Mbit/s\n", traffic.DL.getAvgSpeedInMbits(trafficTimeDuration));
             str.format("Speed UP:  %.3f Mbit/s\n", traffic.UP.getAvgSpeedInMbits(trafficTimeDuration));
             str.addChar('\n');
+            str.format("StdDev DL: %.3f Mbit/s\n", traffic.DL.getSpeedStdDevInMbits());
+            str.format("StdDev UP: %.3f Mbit/s\n", traffic.UP.getSpeedStdDevInMbits());
+            str.addChar('\n');
 
             return str.getLines();
         };
@@ -1394,75 +1669,52 @@ bool showTraffic()
         status::show();
     };
 
-    auto getTrafficStats = [&](TrafficStats &traffic, const char *desc, bool cached = false)
+    do
     {
-        rapidxml::xml_node<> *response;
-
-        if (!cached)
-        {
-            std::string request = "/api/monitoring/";
-
-            if (!strcmp(desc, "CurrentMonth")) request += "month_statistics";
-            else request += "traffic-statistics";
-
-            httpResult.reset();
-            httpOpts.reset();
-
-            response = web::xmlHttpRequest(
-                "Getting Traffic Stats",
-                request.c_str(),
-                httpResult,
-                httpOpts
-            );
-
-            if (!response) return false;
-        }
-        else
-        {
-            response = httpResult.xml.first_node("response");
-        }
+        if (!updateTraffic()) return false;
 
-        if (response->first_node("showtraffic"))
-        {
-            unsigned long long showTraffic = getXMLNum(response, "showtraffic");
-            if (showTraffic == __XML_NUM_ERROR__) return false;
+        pipeline::onSample();
+        printTrafficStats();
+        disableDebugLog("Traffic Loop: ");
 
-            if (showTraffic == 0)
-            {
-                errfunf("showtraffic is set to '0'");
-                return false;
-            }
-        }
+        while (requestLimiter.limit() && !checkExit()) printTrafficStats();
+    } while (!checkExit());
 
-        std::string connectTime = std::string(desc) + "ConnectTime";
-        std::string currentDownload = std::string(desc) + "Download";
-        std::string currentUpload = std::string(desc) + "Upload";
+    enableDebugLog();
+    status::exit();
 
-        if (!strcmp(desc, "CurrentMonth")) connectTime = "MonthDuration";
+    return true;
+}
 
-        updateTime();
+bool exportMetrics()
+{
+    // No screen output, just keep the exporter's page up to date.
+    // WLAN clients are polled less often to avoid slowing down the WebUI.
 
-        traffic.CD.update(getXMLNum(response, connectTime.c_str()));
-        traffic.DL.update(getXMLNum(response, currentDownload.c_str()));
-        traffic.UP.update(getXMLNum(response, currentUpload.c_str()));
+    RequestLimiter<1, 2000> requestLimiter;
+    TimeType lastWlanUpdate = 0;
 
-        return traffic.isSet();
-    };
+    info.linef("Serving metrics on port %d", exporter::port);
 
     do
     {
-        if (!getTrafficStats(currentTraffic, "Current")) return false;
-        if (!getTrafficStats(totalTraffic, "Total", true)) return false;
-        if (!getTrafficStats(monthlyTraffic, "CurrentMonth")) return false;
+        if (!updateSignal()) return false;
+        if (!updateTraffic()) return false;
 
-        printTrafficStats();
-        disableDebugLog("Traffic Loop: ");
+        if (!lastWlanUpdate || timeElapsedGE(lastWlanUpdate, oneSecond * 10))
+        {
+            if (!wlan::updateClients()) return false;
+            db::recordWlanClients();
+            lastWlanUpdate = now;
+        }
 
-        while (requestLimiter.limit() && !checkExit()) printTrafficStats();
+        pipeline::onSample();
+        disableDebugLog("Exporter Loop: ");
+
+        while (requestLimiter.limit() && !checkExit());
     } while (!checkExit());
 
     enableDebugLog();
-    status::exit();
 
     return true;
 }
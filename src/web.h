@@ -78,9 +78,15 @@ bool updateClients();
 
 } // namespace wlan
 
+bool updateSignal();
+bool updateTraffic();
+
 namespace cli {
 
 extern int trafficColumnSpacing;
+extern char signalStrengthColumns[64];
+extern int signalStrengthColumnSpacing;
+extern bool signalStrengthCellTable;
 
 bool showAntennaType();
 bool setAntennaType(const char *antennaType);
@@ -97,6 +103,7 @@ bool showSignalStrength();
 
 bool showWlanClients();
 bool showTraffic();
+bool exportMetrics();
 
 bool connect(const int action = 1);
 bool disconnect();